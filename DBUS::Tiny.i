@@ -8,6 +8,7 @@
 
 %rename receive_uint64_uint32_uint32_string_double_swig receive_uint64_uint32_uint32_string_double;
 %rename get_message_swig get_message;
+%rename try_get_message_swig try_get_message;
 %rename receive_uint32_uint32_string_string_swig receive_uint32_uint32_string_string;
 %rename receive_uint64_x3string_x4double_swig receive_uint64_x3string_x4double;
 %rename receive_x3string_swig receive_x3string;
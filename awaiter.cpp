@@ -0,0 +1,35 @@
+#include <dbus-tiny.h>
+
+#include <dbus/dbus.h>
+
+#include <coroutine>
+#include <utility>
+
+DbusTinyMessageAwaiter::DbusTinyMessageAwaiter(DbusTinyServer &server_in) : server(server_in)
+{
+}
+
+bool DbusTinyMessageAwaiter::await_ready()
+{
+	DBusMessage *message;
+
+	if(!server.message_waiters.empty())
+		return(false);
+
+	if(!(message = server.pop_message()))
+		return(false);
+
+	request.set(server.bus_connection, message, &server.stats);
+
+	return(true);
+}
+
+void DbusTinyMessageAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+	server.message_waiters.push_back({ handle, &request });
+}
+
+DbusTinyRequest DbusTinyMessageAwaiter::await_resume()
+{
+	return(std::move(request));
+}
@@ -1,21 +1,53 @@
 #include <dbus-tiny.h>
 
+#include <limits.h>
 #include <dbus/dbus.h>
 
 #include <string>
+#include <map>
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <exception>
 #include <iostream>
 #include <boost/format.hpp>
 
-DbusTinyClient::DbusTinyClient()
+static const int default_reply_timeout = 25000;
+
+DbusTinyClient::DbusTinyClient() : DbusTinyClient(DbusTinyBus::system)
 {
-	pending_call = nullptr;
+}
+
+DbusTinyClient::DbusTinyClient(DbusTinyBus bus_type_in, const std::string &address)
+{
+	bus_type = bus_type_in;
+	timeout = -1;
+	call_serial = 0;
+	last_call = 0;
+
+	if(!dbus_threads_init_default())
+		throw(DbusTinyException("dbus_threads_init_default failed"));
 
 	dbus_error_init(&dbus_error);
 
-	bus_connection = dbus_bus_get(DBUS_BUS_SYSTEM, &dbus_error);
+	if((bus_type == DbusTinyBus::address) || (bus_type == DbusTinyBus::peer))
+	{
+		if((bus_connection = dbus_connection_open_private(address.c_str(), &dbus_error)) && (bus_type == DbusTinyBus::address))
+			dbus_bus_register(bus_connection, &dbus_error);
+	}
+	else
+		bus_connection = dbus_bus_get((bus_type == DbusTinyBus::session) ? DBUS_BUS_SESSION : DBUS_BUS_SYSTEM, &dbus_error);
 
 	if(dbus_error_is_set(&dbus_error))
-		throw(DbusTinyException(boost::format("dbus bus get failed: %s") % dbus_error.message));
+	{
+		DbusTinyException exception(boost::format("dbus bus get failed: %s") % dbus_error.message);
+
+		dbus_error_free(&dbus_error);
+		release_connection();
+		throw(exception);
+	}
 
 	if(!bus_connection)
 		throw(DbusTinyException("dbus bus get failed (bus_connection = nullptr)"));
@@ -33,154 +65,181 @@ DbusTinyClient::DbusTinyClient()
 	rv_double_2 = 0;
 	rv_double_3 = 0;
 	signal_serial = 0;
+	signal_batch = false;
 }
 
-void DbusTinyClient::send_void(const std::string &service, const std::string &interface, const std::string &method)
+DbusTinyClient::~DbusTinyClient()
 {
-	DBusMessage *request_message;
+	for(auto &pending_call : pending_calls)
+	{
+		dbus_pending_call_cancel(pending_call.second.pending_call);
+		dbus_pending_call_unref(pending_call.second.pending_call);
+	}
 
-	try
+	for(auto &async_call : async_calls)
 	{
-		request_message = nullptr;
-		pending_call = nullptr;
+		dbus_pending_call_cancel(async_call.second.pending_call);
+		dbus_pending_call_unref(async_call.second.pending_call);
+	}
 
-		if(!domain_valid(service))
-			throw(DbusTinyInternalException("invalid service"));
+	if((bus_type == DbusTinyBus::address) || (bus_type == DbusTinyBus::peer))
+	{
+		dbus_connection_close(bus_connection);
+		dbus_connection_unref(bus_connection);
+	}
+}
 
-		if((interface != "") && !domain_valid(interface))
-			throw(DbusTinyInternalException("invalid interface"));
+void DbusTinyClient::release_connection()
+{
+	if(!bus_connection)
+		return;
 
-		if(!(request_message = dbus_message_new_method_call(service.c_str(), "/", (interface == "") ? nullptr : interface.c_str(), method.c_str())))
-			throw(DbusTinyInternalException("error in dbus_message_new_method_call"));
+	if((bus_type == DbusTinyBus::address) || (bus_type == DbusTinyBus::peer))
+		dbus_connection_close(bus_connection);
 
-		if(!dbus_connection_send_with_reply(bus_connection, request_message, &pending_call, -1))
-			throw(DbusTinyInternalException("error in dbus_connection_send_with_reply"));
+	dbus_connection_unref(bus_connection);
+	bus_connection = nullptr;
+}
 
-		if(!pending_call)
-			throw(DbusTinyInternalException("nullptr in dbus_connection_send_with_reply"));
-	}
-	catch(const DbusTinyInternalException &e)
-	{
-		std::string rv = std::string("send_void: ") + e.what();
+void DbusTinyClient::set_timeout(int milliseconds)
+{
+	timeout = milliseconds;
+}
 
-		if(dbus_error_is_set(&dbus_error))
-		{
-			dbus_error_free(&dbus_error);
-			rv += std::string(" (dbus error: ") + dbus_error.message + ")";
-		}
+int DbusTinyClient::get_timeout()
+{
+	return(timeout);
+}
 
-		if(pending_call)
-		{
-			dbus_pending_call_unref(pending_call);
-			pending_call = nullptr;
-		}
+unsigned int DbusTinyClient::send_void(const std::string &service, const std::string &interface, const std::string &method)
+{
+	return(send(service, interface, method));
+}
 
-		if(request_message)
-			dbus_message_unref(request_message);
+unsigned int DbusTinyClient::send_string(const std::string &service, const std::string &interface, const std::string &method, const std::string &parameter)
+{
+	return(send(service, interface, method, parameter));
+}
 
-		throw(DbusTinyException(rv));
-	}
+unsigned int DbusTinyClient::send_uint32_uint32_string_string(const std::string &service, const std::string &interface, const std::string &method,
+		uint32_t p0u32, uint32_t p1u32, const std::string &p2s, const std::string &p3s)
+{
+	return(send(service, interface, method, p0u32, p1u32, p2s, p3s));
+}
 
-	dbus_connection_flush(bus_connection);
-	dbus_message_unref(request_message);
+unsigned int DbusTinyClient::send_x3string(const std::string &service, const std::string &interface, const std::string &method, const std::string &p0, const std::string &p1, const std::string &p2)
+{
+	return(send(service, interface, method, p0, p1, p2));
 }
 
-void DbusTinyClient::send_string(const std::string &service, const std::string &interface, const std::string &method, const std::string &parameter)
+const std::string &DbusTinyClient::receive_string()
 {
-	DBusMessage *request_message;
+	return(receive_string(last_call));
+}
 
-	try
-	{
-		const char *cstr;
+const std::string &DbusTinyClient::receive_string(unsigned int call)
+{
+	receive(call, rv_string_0);
 
-		request_message = nullptr;
-		pending_call = nullptr;
+	return(rv_string_0);
+}
 
-		if(!domain_valid(service))
-			throw(DbusTinyInternalException("invalid service"));
+void DbusTinyClient::receive_uint64_uint32_uint32_string_double(uint64_t &p1u64, uint32_t &p2u32, uint32_t &p3u32, std::string &p4s, double &p5d)
+{
+	receive_uint64_uint32_uint32_string_double(last_call, p1u64, p2u32, p3u32, p4s, p5d);
+}
 
-		if((interface != "") && !domain_valid(interface))
-			throw(DbusTinyInternalException("invalid interface"));
+void DbusTinyClient::receive_uint64_uint32_uint32_string_double(unsigned int call, uint64_t &p1u64, uint32_t &p2u32, uint32_t &p3u32, std::string &p4s, double &p5d)
+{
+	receive(call, p1u64, p2u32, p3u32, p4s, p5d);
+}
 
-		if(!(request_message = dbus_message_new_method_call(service.c_str(), "/", (interface == "") ? nullptr : interface.c_str(), method.c_str())))
-			throw(DbusTinyInternalException("error in dbus_message_new_method_call"));
+void DbusTinyClient::receive_uint64_uint32_uint32_string_double_swig()
+{
+	receive_uint64_uint32_uint32_string_double(last_call, rv_uint64_0, rv_uint32_0, rv_uint32_1, rv_string_0, rv_double_0);
+}
 
-		cstr = parameter.c_str();
+void DbusTinyClient::receive_uint64_uint32_uint32_string_double_swig(unsigned int call)
+{
+	receive_uint64_uint32_uint32_string_double(call, rv_uint64_0, rv_uint32_0, rv_uint32_1, rv_string_0, rv_double_0);
+}
 
-		if(!dbus_message_append_args(request_message, DBUS_TYPE_STRING, &cstr, DBUS_TYPE_INVALID))
-			throw(DbusTinyInternalException("error in dbus_message_append_args"));
+void DbusTinyClient::receive_uint64_x3string_x4double(uint64_t &p0, std::string &p1, std::string &p2, std::string &p3, double &p4, double &p5, double &p6, double &p7)
+{
+	receive_uint64_x3string_x4double(last_call, p0, p1, p2, p3, p4, p5, p6, p7);
+}
 
-		if(!dbus_connection_send_with_reply(bus_connection, request_message, &pending_call, -1))
-			throw(DbusTinyInternalException("error in dbus_connection_send_with_reply"));
+void DbusTinyClient::receive_uint64_x3string_x4double(unsigned int call, uint64_t &p0, std::string &p1, std::string &p2, std::string &p3, double &p4, double &p5, double &p6, double &p7)
+{
+	receive(call, p0, p1, p2, p3, p4, p5, p6, p7);
+}
 
-		if(!pending_call)
-			throw(DbusTinyInternalException("pending connection is nullptr in dbus_connection_send_with_reply"));
-	}
-	catch(const DbusTinyInternalException &e)
-	{
-		std::string rv = std::string("send_string: ") + e.what();
+void DbusTinyClient::receive_uint64_x3string_x4double_swig()
+{
+	receive_uint64_x3string_x4double(last_call, rv_uint64_0, rv_string_0, rv_string_1, rv_string_2, rv_double_0, rv_double_1, rv_double_2, rv_double_3);
+}
 
-		if(dbus_error_is_set(&dbus_error))
-		{
-			dbus_error_free(&dbus_error);
-			rv += std::string(" (dbus error: ") + dbus_error.message + ")";
-		}
+void DbusTinyClient::receive_uint64_x3string_x4double_swig(unsigned int call)
+{
+	receive_uint64_x3string_x4double(call, rv_uint64_0, rv_string_0, rv_string_1, rv_string_2, rv_double_0, rv_double_1, rv_double_2, rv_double_3);
+}
 
-		if(pending_call)
-		{
-			dbus_pending_call_unref(pending_call);
-			pending_call = nullptr;
-		}
+void DbusTinyClient::receive_uint32_x3uint64(uint32_t &p0, uint64_t &p1, uint64_t &p2, uint64_t &p3)
+{
+	receive_uint32_x3uint64(last_call, p0, p1, p2, p3);
+}
 
-		if(request_message)
-			dbus_message_unref(request_message);
+void DbusTinyClient::receive_uint32_x3uint64(unsigned int call, uint32_t &p0, uint64_t &p1, uint64_t &p2, uint64_t &p3)
+{
+	receive(call, p0, p1, p2, p3);
+}
 
-		throw(DbusTinyException(rv));
-	}
+void DbusTinyClient::receive_uint32_x3uint64_swig()
+{
+	receive_uint32_x3uint64(last_call, rv_uint32_0, rv_uint64_0, rv_uint64_1, rv_uint64_2);
+}
 
-	dbus_connection_flush(bus_connection);
-	dbus_message_unref(request_message);
+void DbusTinyClient::receive_uint32_x3uint64_swig(unsigned int call)
+{
+	receive_uint32_x3uint64(call, rv_uint32_0, rv_uint64_0, rv_uint64_1, rv_uint64_2);
 }
 
-void DbusTinyClient::send_uint32_uint32_string_string(const std::string &service, const std::string &interface, const std::string &method,
-		uint32_t p0u32, uint32_t p1u32, const std::string &p2s, const std::string &p3s)
+void DbusTinyClient::signal_string(const std::string &service, const std::string &interface, const std::string &signal, const std::string &parameter)
 {
-	DBusMessage *request_message;
+	DBusMessage *signal_message;
+	dbus_uint32_t serial;
 
 	try
 	{
-		const char *p2cs, *p3cs;
+		const char *cstr;
 
-		request_message = nullptr;
-		pending_call = nullptr;
+		signal_message = nullptr;
 
-		if(!domain_valid(service))
+		if(!path_valid(service))
 			throw(DbusTinyInternalException("invalid service"));
 
-		if((interface != "") && !domain_valid(interface))
+		if(!domain_valid(interface))
 			throw(DbusTinyInternalException("invalid interface"));
 
-		if(method.find('-') != std::string::npos)
-			throw(DbusTinyInternalException("invalid method name in dbus_message_new_method_call"));
-
-		if(!(request_message = dbus_message_new_method_call(service.c_str(), "/", (interface == "") ? nullptr : interface.c_str(), method.c_str())))
-			throw(DbusTinyInternalException("error in dbus_message_new_method_call"));
+		if(!(signal_message = dbus_message_new_signal(service.c_str(), interface.c_str(), signal.c_str())))
+			throw(DbusTinyInternalException("error in dbus_message_new_signal"));
 
-		p2cs = p2s.c_str();
-		p3cs = p3s.c_str();
+		cstr = parameter.c_str();
 
-		if(!dbus_message_append_args(request_message, DBUS_TYPE_UINT32, &p0u32, DBUS_TYPE_UINT32, &p1u32, DBUS_TYPE_STRING, &p2cs, DBUS_TYPE_STRING, &p3cs, DBUS_TYPE_INVALID))
+		if(!dbus_message_append_args(signal_message, DBUS_TYPE_STRING, &cstr, DBUS_TYPE_INVALID))
 			throw(DbusTinyInternalException("error in dbus_message_append_args"));
 
-		if(!dbus_connection_send_with_reply(bus_connection, request_message, &pending_call, -1))
-			throw(DbusTinyInternalException("error in dbus_connection_send_with_reply"));
+		serial = signal_serial++;
+
+		if(!dbus_connection_send(bus_connection, signal_message, &serial))
+			throw(DbusTinyInternalException("error in dbus_connection_send"));
+
+		DbusTinyStats::add(stats.signals_sent);
 
-		if(!pending_call)
-			throw(DbusTinyInternalException("pending connection is nullptr in dbus_connection_send_with_reply"));
 	}
 	catch(const DbusTinyInternalException &e)
 	{
-		std::string rv = std::string("send_uint32_uint32_string_string: ") + e.what();
+		std::string rv = std::string("signal_string: ") + e.what();
 
 		if(dbus_error_is_set(&dbus_error))
 		{
@@ -188,471 +247,527 @@ void DbusTinyClient::send_uint32_uint32_string_string(const std::string &service
 			rv += std::string(" (dbus error: ") + dbus_error.message + ")";
 		}
 
-		if(pending_call)
-		{
-			dbus_pending_call_unref(pending_call);
-			pending_call = nullptr;
-		}
-
-		if(request_message)
-			dbus_message_unref(request_message);
+		if(signal_message)
+			dbus_message_unref(signal_message);
 
 		throw(DbusTinyException(rv));
 	}
 
-	dbus_connection_flush(bus_connection);
-	dbus_message_unref(request_message);
+	if(!signal_batch)
+		dbus_connection_flush(bus_connection);
+
+	dbus_message_unref(signal_message);
 }
 
-void DbusTinyClient::send_x3string(const std::string &service, const std::string &interface, const std::string &method, const std::string &p0, const std::string &p1, const std::string &p2)
+void DbusTinyClient::signal_string_batch(const std::string &service, const std::string &interface, const std::vector<std::pair<std::string, std::string>> &signals)
 {
-	DBusMessage *request_message;
-
-	try
+	struct batch_guard
 	{
-		const char *s0, *s1, *s2;
+		DbusTinyClient &client;
+		bool previous;
 
-		request_message = nullptr;
-		pending_call = nullptr;
+		~batch_guard()
+		{
+			client.signal_batch = previous;
 
-		if(!domain_valid(service))
-			throw(DbusTinyInternalException("invalid service"));
+			if(!previous)
+				client.flush();
+		}
+	} guard{ *this, signal_batch };
 
-		if((interface != "") && !domain_valid(interface))
-			throw(DbusTinyInternalException("invalid interface"));
+	signal_batch = true;
 
-		if(method.find('-') != std::string::npos)
-			throw(DbusTinyInternalException("invalid method name in dbus_message_new_method_call"));
+	for(const auto &signal : signals)
+		signal_string(service, interface, signal.first, signal.second);
+}
 
-		if(!(request_message = dbus_message_new_method_call(service.c_str(), "/", (interface == "") ? nullptr : interface.c_str(), method.c_str())))
-			throw(DbusTinyInternalException("error in dbus_message_new_method_call"));
+void DbusTinyClient::signal_batch_begin()
+{
+	signal_batch = true;
+}
 
-		s0 = p0.c_str();
-		s1 = p1.c_str();
-		s2 = p2.c_str();
+void DbusTinyClient::signal_batch_commit()
+{
+	signal_batch = false;
+	flush();
+}
 
-		if(!dbus_message_append_args(request_message,
-					DBUS_TYPE_STRING, &s0,
-					DBUS_TYPE_STRING, &s1,
-					DBUS_TYPE_STRING, &s2,
-					DBUS_TYPE_INVALID))
-			throw(DbusTinyInternalException("error in dbus_message_append_args"));
+void DbusTinyClient::flush()
+{
+	if(dbus_connection_has_messages_to_send(bus_connection))
+		dbus_connection_flush(bus_connection);
+}
 
-		if(!dbus_connection_send_with_reply(bus_connection, request_message, &pending_call, -1))
-			throw(DbusTinyInternalException("error in dbus_connection_send_with_reply"));
+const std::string &DbusTinyClient::get_rv_string_0()
+{
+	return(rv_string_0);
+}
 
-		if(!pending_call)
-			throw(DbusTinyInternalException("pending connection is nullptr in dbus_connection_send_with_reply"));
-	}
-	catch(const DbusTinyInternalException &e)
-	{
-		std::string rv = std::string("send_x3string: ") + e.what();
+const std::string &DbusTinyClient::get_rv_string_1()
+{
+	return(rv_string_1);
+}
 
-		if(dbus_error_is_set(&dbus_error))
-		{
-			dbus_error_free(&dbus_error);
-			rv += std::string(" (dbus error: ") + dbus_error.message + ")";
-		}
+const std::string &DbusTinyClient::get_rv_string_2()
+{
+	return(rv_string_2);
+}
 
-		if(pending_call)
-		{
-			dbus_pending_call_unref(pending_call);
-			pending_call = nullptr;
-		}
+uint64_t DbusTinyClient::get_rv_uint64_0()
+{
+	return(rv_uint64_0);
+}
 
-		if(request_message)
-			dbus_message_unref(request_message);
+uint64_t DbusTinyClient::get_rv_uint64_1()
+{
+	return(rv_uint64_1);
+}
 
-		throw(DbusTinyException(rv));
-	}
+uint64_t DbusTinyClient::get_rv_uint64_2()
+{
+	return(rv_uint64_2);
+}
 
-	dbus_connection_flush(bus_connection);
-	dbus_message_unref(request_message);
+uint32_t DbusTinyClient::get_rv_uint32_0()
+{
+	return(rv_uint32_0);
 }
 
-const std::string& DbusTinyClient::receive_string()
+uint32_t DbusTinyClient::get_rv_uint32_1()
 {
-	DBusMessage *reply_message;
+	return(rv_uint32_1);
+}
 
-	try
-	{
-		const char *cstr;
+double DbusTinyClient::get_rv_double_0()
+{
+	return(rv_double_0);
+}
 
-		reply_message = nullptr;
+double DbusTinyClient::get_rv_double_1()
+{
+	return(rv_double_1);
+}
 
-		if(!pending_call)
-			throw(DbusTinyInternalException("no call pending"));
+double DbusTinyClient::get_rv_double_2()
+{
+	return(rv_double_2);
+}
 
-		dbus_pending_call_block(pending_call);
+double DbusTinyClient::get_rv_double_3()
+{
+	return(rv_double_3);
+}
 
-		if(!(reply_message = dbus_pending_call_steal_reply(pending_call)))
-			throw(DbusTinyInternalException("nullptr in dbus_pending_call_steal_reply"));
+DbusTinyResult DbusTinyClient::build_call(DBusMessage *&request_message, const std::string &service, const std::string &interface, const std::string &method, const std::string &path)
+{
+	request_message = nullptr;
 
-		dbus_pending_call_unref(pending_call);
-		pending_call = nullptr;
+	if(!domain_valid(service))
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_INVALID_ARGS, "invalid service"));
 
-		if(dbus_message_get_type(reply_message) == DBUS_MESSAGE_TYPE_ERROR)
-		{
-			dbus_message_get_args(reply_message, &dbus_error, DBUS_TYPE_STRING, &cstr, DBUS_TYPE_INVALID);
+	if((interface != "") && !domain_valid(interface))
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_INVALID_ARGS, "invalid interface"));
 
-			if(dbus_error_is_set(&dbus_error))
-				throw(DbusTinyInternalException("error in dbus_message_get_args while processing error"));
+	if(method.find('-') != std::string::npos)
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_INVALID_ARGS, "invalid method name in dbus_message_new_method_call"));
 
-			throw(DbusTinyInternalException(boost::format("error while receiving reply: %s") % cstr));
-		}
+	if(!path_valid(path))
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_INVALID_ARGS, "invalid path"));
 
-		dbus_message_get_args(reply_message, &dbus_error, DBUS_TYPE_STRING, &cstr, DBUS_TYPE_INVALID);
+	if(!(request_message = dbus_message_new_method_call(service.c_str(), path.c_str(), (interface == "") ? nullptr : interface.c_str(), method.c_str())))
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_NO_MEMORY, "error in dbus_message_new_method_call"));
 
-		if(dbus_error_is_set(&dbus_error))
-			throw(DbusTinyInternalException("error in dbus_message_get_args"));
+	return(DbusTinyResult());
+}
+
+DBusMessage *DbusTinyClient::new_call(const std::string &service, const std::string &interface, const std::string &method, const std::string &path)
+{
+	DBusMessage *request_message;
+	DbusTinyResult result;
+
+	if(!(result = build_call(request_message, service, interface, method, path)))
+		result.raise("send: ");
+
+	return(request_message);
+}
 
-		dbus_message_unref(reply_message);
+DbusTinyResult DbusTinyClient::queue_send(DBusMessage *request_message, int milliseconds, unsigned int &call)
+{
+	DBusPendingCall *pending_call;
 
-		rv_string_0 = cstr;
+	pending_call = nullptr;
 
-		return(rv_string_0);
+	if(!dbus_connection_send_with_reply(bus_connection, request_message, &pending_call, milliseconds))
+	{
+		dbus_message_unref(request_message);
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_NO_MEMORY, "error in dbus_connection_send_with_reply"));
 	}
-	catch(const DbusTinyInternalException &e)
+
+	if(!pending_call)
 	{
-		std::string e1 = std::string("receive_string: ") + e.what();
+		dbus_message_unref(request_message);
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_DISCONNECTED, "pending connection is nullptr in dbus_connection_send_with_reply"));
+	}
 
-		if(dbus_error_is_set(&dbus_error))
-		{
-			dbus_error_free(&dbus_error);
-			e1 += std::string(" (dbus error: ") + dbus_error.message + ")";
-		}
+	dbus_message_unref(request_message);
 
-		if(reply_message)
-			dbus_message_unref(reply_message);
+	DbusTinyStats::add(stats.calls_sent);
 
-		if(pending_call)
-		{
-			dbus_pending_call_unref(pending_call);
-			pending_call = nullptr;
-		}
+	call = queue_call(pending_call, milliseconds);
 
-		throw(DbusTinyException(e1));
-	}
+	return(DbusTinyResult());
 }
 
-void DbusTinyClient::receive_uint64_uint32_uint32_string_double(uint64_t &p1u64, uint32_t &p2u32, uint32_t &p3u32, std::string &p4s, double &p5d)
+unsigned int DbusTinyClient::send_call(DBusMessage *request_message, int milliseconds)
 {
-	DBusMessage *reply_message = nullptr;
+	DbusTinyResult result;
+	unsigned int call;
 
-	try
-	{
-		const char *p4cs;
+	if(!(result = queue_send(request_message, milliseconds, call)))
+		result.raise("send: ");
 
-		if(!pending_call)
-			throw(DbusTinyInternalException("no call pending"));
+	return(call);
+}
 
-		dbus_pending_call_block(pending_call);
+void DbusTinyClient::append_failed(DBusMessage *request_message)
+{
+	dbus_message_unref(request_message);
 
-		if(!(reply_message = dbus_pending_call_steal_reply(pending_call)))
-			throw(DbusTinyInternalException("nullptr in dbus_pending_call_steal_reply"));
+	throw(DbusTinyException("send: error in dbus_message_iter_append"));
+}
 
-		dbus_pending_call_unref(pending_call);
-		pending_call = nullptr;
+void DbusTinyClient::fds_unsupported(DBusMessage *request_message)
+{
+	dbus_message_unref(request_message);
 
-		if(dbus_message_get_type(reply_message) == DBUS_MESSAGE_TYPE_ERROR)
-		{
-			dbus_message_get_args(reply_message, &dbus_error, DBUS_TYPE_STRING, &p4cs, DBUS_TYPE_INVALID);
+	throw(DbusTinyException("send: connection cannot pass unix fds"));
+}
 
-			if(dbus_error_is_set(&dbus_error))
-				throw(DbusTinyInternalException("error in dbus_message_get_args while processing error"));
+DbusTinyResult DbusTinyClient::wait_reply(unsigned int call, const std::chrono::steady_clock::time_point *deadline, DBusMessage *&reply_message)
+{
+	DBusPendingCall *pending_call;
+	std::chrono::steady_clock::time_point expiry;
+	std::chrono::steady_clock::time_point now;
+	std::chrono::milliseconds::rep remaining;
 
-			throw(DbusTinyInternalException(boost::format("error while receiving reply: %s") % p4cs));
-		}
+	reply_message = nullptr;
 
-		dbus_message_get_args(reply_message, &dbus_error,
-				DBUS_TYPE_UINT64, &p1u64, DBUS_TYPE_UINT32, &p2u32, DBUS_TYPE_UINT32, &p3u32, DBUS_TYPE_STRING, &p4cs, DBUS_TYPE_DOUBLE, &p5d, DBUS_TYPE_INVALID);
+	if(!(pending_call = dequeue_call(call, expiry)))
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_FAILED, "no call pending"));
 
-		if(dbus_error_is_set(&dbus_error))
-			throw(DbusTinyInternalException("error in dbus_message_get_args"));
+	flush();
 
-		dbus_message_unref(reply_message);
+	if(!deadline)
+	{
+		DbusTinyStatsTimer timer(stats.wait);
 
-		p4s = p4cs;
+		dbus_pending_call_block(pending_call);
 	}
-	catch(const DbusTinyInternalException &e)
+	else
 	{
-		std::string e1 = std::string("receive_uint64_uint32_uint32_string_double: ") + e.what();
+		DbusTinyStatsTimer timer(stats.wait);
 
-		if(dbus_error_is_set(&dbus_error))
+		while(!dbus_pending_call_get_completed(pending_call))
 		{
-			dbus_error_free(&dbus_error);
-			e1 += std::string(" (dbus error: ") + dbus_error.message + ")";
+			now = std::chrono::steady_clock::now();
+
+			if(now >= expiry)
+			{
+				dbus_pending_call_cancel(pending_call);
+				dbus_pending_call_unref(pending_call);
+				DbusTinyStats::add(stats.timeouts);
+				return(DbusTinyResult(DbusTinyStatus::timeout, DBUS_ERROR_NO_REPLY, "reply timed out"));
+			}
+
+			if(now >= *deadline)
+			{
+				pending_calls[call] = pending_entry{ pending_call, expiry };
+				return(DbusTinyResult(DbusTinyStatus::timeout, DBUS_ERROR_TIMEOUT, "no reply before deadline"));
+			}
+
+			remaining = std::chrono::ceil<std::chrono::milliseconds>(std::min(expiry, *deadline) - now).count();
+
+			if(!dbus_connection_read_write_dispatch(bus_connection, static_cast<int>(std::min<std::chrono::milliseconds::rep>(remaining, INT_MAX))))
+			{
+				dbus_pending_call_unref(pending_call);
+				return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_DISCONNECTED, "connection closed"));
+			}
 		}
+	}
 
-		if(reply_message)
-			dbus_message_unref(reply_message);
+	reply_message = dbus_pending_call_steal_reply(pending_call);
+	dbus_pending_call_unref(pending_call);
 
-		if(pending_call)
-		{
-			dbus_pending_call_unref(pending_call);
-			pending_call = nullptr;
-		}
+	if(!reply_message)
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_FAILED, "nullptr in dbus_pending_call_steal_reply"));
+
+	stats.received(reply_message);
+
+	if(dbus_message_get_type(reply_message) == DBUS_MESSAGE_TYPE_ERROR)
+	{
+		DbusTinyResult result(reply_message);
+
+		reply_message = nullptr;
+
+		if(result.get_status() == DbusTinyStatus::timeout)
+			DbusTinyStats::add(stats.timeouts);
 
-		throw(DbusTinyException(e1));
+		return(result);
 	}
-}
 
-void DbusTinyClient::receive_uint64_uint32_uint32_string_double_swig()
-{
-	receive_uint64_uint32_uint32_string_double(rv_uint64_0, rv_uint32_0, rv_uint32_1, rv_string_0, rv_double_0);
+	return(DbusTinyResult());
 }
 
-void DbusTinyClient::receive_uint64_x3string_x4double(uint64_t &p0, std::string &p1, std::string &p2, std::string &p3, double &p4, double &p5, double &p6, double &p7)
+DBusMessage *DbusTinyClient::receive_reply(unsigned int call, const std::chrono::steady_clock::time_point *deadline)
 {
-	DBusMessage *reply_message = nullptr;
-
-	try
-	{
-		const char *p1cs;
-		const char *p2cs;
-		const char *p3cs;
+	DBusMessage *reply_message;
+	DbusTinyResult result;
 
-		if(!pending_call)
-			throw(DbusTinyInternalException("no call pending"));
+	if((result = wait_reply(call, deadline, reply_message)))
+		return(reply_message);
 
-		dbus_pending_call_block(pending_call);
+	if(deadline && (result.get_error_name() == DBUS_ERROR_TIMEOUT))
+		return(nullptr);
 
-		if(!(reply_message = dbus_pending_call_steal_reply(pending_call)))
-			throw(DbusTinyInternalException("nullptr in dbus_pending_call_steal_reply"));
+	result.raise("receive: ");
+}
 
-		dbus_pending_call_unref(pending_call);
-		pending_call = nullptr;
+void DbusTinyClient::receive_failed(DBusMessage *reply_message, const char *signature)
+{
+	std::string error;
 
-		if(dbus_message_get_type(reply_message) == DBUS_MESSAGE_TYPE_ERROR)
-		{
-			dbus_message_get_args(reply_message, &dbus_error, DBUS_TYPE_STRING, &p1cs, DBUS_TYPE_INVALID);
+	error = (boost::format("receive: invalid reply, expected signature \"%s\", received \"%s\"") % signature % dbus_message_get_signature(reply_message)).str();
 
-			if(dbus_error_is_set(&dbus_error))
-				throw(DbusTinyInternalException("error in dbus_message_get_args while processing error"));
+	dbus_message_unref(reply_message);
 
-			throw(DbusTinyInternalException(boost::format("error while receiving reply: %s") % p1cs));
-		}
+	throw(DbusTinyException(error));
+}
 
-		dbus_message_get_args(reply_message, &dbus_error, DBUS_TYPE_UINT64, &p0,
-				DBUS_TYPE_STRING, &p1cs, DBUS_TYPE_STRING, &p2cs, DBUS_TYPE_STRING, &p3cs,
-				DBUS_TYPE_DOUBLE, &p4, DBUS_TYPE_DOUBLE, &p5, DBUS_TYPE_DOUBLE, &p6, DBUS_TYPE_DOUBLE, &p7, DBUS_TYPE_INVALID);
+unsigned int DbusTinyClient::queue_call(DBusPendingCall *pending_call, int milliseconds)
+{
+	pending_entry entry;
 
-		if(dbus_error_is_set(&dbus_error))
-			throw(DbusTinyInternalException("error in dbus_message_get_args"));
+	if(++call_serial == 0)
+		call_serial = 1;
 
-		dbus_message_unref(reply_message);
+	entry.pending_call = pending_call;
 
-		p1 = p1cs;
-		p2 = p2cs;
-		p3 = p3cs;
-	}
-	catch(const DbusTinyInternalException &e)
-	{
-		std::string e1 = std::string("receive_uint64_x3string_x4double: ") + e.what();
+	if(milliseconds < 0)
+		milliseconds = default_reply_timeout;
 
-		if(dbus_error_is_set(&dbus_error))
-		{
-			dbus_error_free(&dbus_error);
-			e1 += std::string(" (dbus error: ") + dbus_error.message + ")";
-		}
+	if(milliseconds == DBUS_TIMEOUT_INFINITE)
+		entry.expiry = std::chrono::steady_clock::time_point::max();
+	else
+		entry.expiry = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
 
-		if(reply_message)
-			dbus_message_unref(reply_message);
+	pending_calls[call_serial] = entry;
+	last_call = call_serial;
 
-		if(pending_call)
-		{
-			dbus_pending_call_unref(pending_call);
-			pending_call = nullptr;
-		}
-
-		throw(DbusTinyException(e1));
-	}
+	return(call_serial);
 }
 
-void DbusTinyClient::receive_uint64_x3string_x4double_swig()
+bool DbusTinyClient::cancel(unsigned int call)
 {
-	receive_uint64_x3string_x4double(rv_uint64_0, rv_string_0, rv_string_1, rv_string_2, rv_double_0, rv_double_1, rv_double_2, rv_double_3);
+	std::chrono::steady_clock::time_point expiry;
+	DBusPendingCall *pending_call;
+
+	if(!(pending_call = dequeue_call(call, expiry)))
+		return(false);
+
+	dbus_pending_call_cancel(pending_call);
+	dbus_pending_call_unref(pending_call);
+
+	return(true);
 }
 
-void DbusTinyClient::receive_uint32_x3uint64(uint32_t &p0, uint64_t &p1, uint64_t &p2, uint64_t &p3)
+DBusPendingCall *DbusTinyClient::dequeue_call(unsigned int call, std::chrono::steady_clock::time_point &expiry)
 {
-	DBusMessage *reply_message = nullptr;
+	std::map<unsigned int, pending_entry>::iterator it;
+	DBusPendingCall *pending_call;
 
-	try
-	{
-		const char *p1cs;
+	if((it = pending_calls.find(call)) == pending_calls.end())
+		return(nullptr);
 
-		if(!pending_call)
-			throw(DbusTinyInternalException("no call pending"));
+	pending_call = it->second.pending_call;
+	expiry = it->second.expiry;
+	pending_calls.erase(it);
 
-		dbus_pending_call_block(pending_call);
-
-		if(!(reply_message = dbus_pending_call_steal_reply(pending_call)))
-			throw(DbusTinyInternalException("nullptr in dbus_pending_call_steal_reply"));
+	return(pending_call);
+}
 
-		dbus_pending_call_unref(pending_call);
-		pending_call = nullptr;
+void DbusTinyClient::set_executor(DbusTinyExecutor executor_in)
+{
+	executor = executor_in;
+}
 
-		if(dbus_message_get_type(reply_message) == DBUS_MESSAGE_TYPE_ERROR)
+void DbusTinyClient::process(int milliseconds)
+{
+	std::chrono::steady_clock::time_point now;
+	std::chrono::milliseconds::rep remaining;
+	std::exception_ptr exception;
+	async_entry entry;
+
+	if(dbus_connection_get_dispatch_status(bus_connection) == DBUS_DISPATCH_DATA_REMAINS)
+		milliseconds = 0;
+	else
+	{
+		if(!async_calls.empty())
 		{
-			dbus_message_get_args(reply_message, &dbus_error, DBUS_TYPE_STRING, &p1cs, DBUS_TYPE_INVALID);
-
-			if(dbus_error_is_set(&dbus_error))
-				throw(DbusTinyInternalException("error in dbus_message_get_args while processing error"));
+			remaining = std::chrono::ceil<std::chrono::milliseconds>(async_calls.begin()->first - std::chrono::steady_clock::now()).count();
+			remaining = std::clamp<std::chrono::milliseconds::rep>(remaining, 0, INT_MAX);
 
-			throw(DbusTinyInternalException(boost::format("error while receiving reply: %s") % p1cs));
+			if((milliseconds < 0) || (remaining < milliseconds))
+				milliseconds = static_cast<int>(remaining);
 		}
+	}
 
-		dbus_message_get_args(reply_message, &dbus_error,
-
-				DBUS_TYPE_UINT32, &p0,
-				DBUS_TYPE_UINT64, &p1,
-				DBUS_TYPE_UINT64, &p2,
-				DBUS_TYPE_UINT64, &p3,
-				DBUS_TYPE_INVALID);
-
-		if(dbus_error_is_set(&dbus_error))
-			throw(DbusTinyInternalException("error in dbus_message_get_args"));
+	{
+		DbusTinyStatsTimer timer(stats.wait);
 
-		dbus_message_unref(reply_message);
+		if(!dbus_connection_read_write(bus_connection, milliseconds))
+			throw(DbusTinyException("process: connection closed"));
 	}
-	catch(const DbusTinyInternalException &e)
-	{
-		std::string e1 = std::string("receive_uint32_x3uint64: ") + e.what();
 
-		if(dbus_error_is_set(&dbus_error))
-		{
-			dbus_error_free(&dbus_error);
-			e1 += std::string(" (dbus error: ") + dbus_error.message + ")";
-		}
+	while(dbus_connection_dispatch(bus_connection) == DBUS_DISPATCH_DATA_REMAINS)
+		continue;
 
-		if(reply_message)
-			dbus_message_unref(reply_message);
+	now = std::chrono::steady_clock::now();
 
-		if(pending_call)
-		{
-			dbus_pending_call_unref(pending_call);
-			pending_call = nullptr;
-		}
+	while(!async_calls.empty() && (async_calls.begin()->first <= now))
+	{
+		entry = async_calls.begin()->second;
+		async_calls.erase(async_calls.begin());
 
-		throw(DbusTinyException(e1));
+		dbus_pending_call_cancel(entry.pending_call);
+		complete_async(entry.context, nullptr);
+		dbus_pending_call_unref(entry.pending_call);
+	}
+
+	if(async_exception)
+	{
+		exception = async_exception;
+		async_exception = nullptr;
+		std::rethrow_exception(exception);
 	}
 }
 
-void DbusTinyClient::receive_uint32_x3uint64_swig()
+int DbusTinyClient::get_poll_fd()
 {
-	receive_uint32_x3uint64(rv_uint32_0, rv_uint64_0, rv_uint64_1, rv_uint64_2);
+	int fd;
+
+	if(!dbus_connection_get_unix_fd(bus_connection, &fd))
+		return(-1);
+
+	return(fd);
 }
 
-void DbusTinyClient::signal_string(const std::string &service, const std::string &interface, const std::string &signal, const std::string &parameter)
+int DbusTinyClient::get_poll_timeout()
 {
-	DBusMessage *signal_message;
-	dbus_uint32_t serial;
-
-	try
-	{
-		const char *cstr;
+	std::chrono::milliseconds::rep remaining;
 
-		signal_message = nullptr;
+	if((dbus_connection_get_dispatch_status(bus_connection) == DBUS_DISPATCH_DATA_REMAINS) || dbus_connection_has_messages_to_send(bus_connection))
+		return(0);
 
-		if(!path_valid(service))
-			throw(DbusTinyInternalException("invalid service"));
+	if(async_calls.empty() || (async_calls.begin()->first == std::chrono::steady_clock::time_point::max()))
+		return(-1);
 
-		if(!domain_valid(interface))
-			throw(DbusTinyInternalException("invalid interface"));
+	remaining = std::chrono::ceil<std::chrono::milliseconds>(async_calls.begin()->first - std::chrono::steady_clock::now()).count();
 
-		if(!(signal_message = dbus_message_new_signal(service.c_str(), interface.c_str(), signal.c_str())))
-			throw(DbusTinyInternalException("error in dbus_message_new_signal"));
+	return(static_cast<int>(std::clamp<std::chrono::milliseconds::rep>(remaining, 0, INT_MAX)));
+}
 
-		cstr = parameter.c_str();
+unsigned int DbusTinyClient::get_async_pending()
+{
+	return(async_calls.size());
+}
 
-		if(!dbus_message_append_args(signal_message, DBUS_TYPE_STRING, &cstr, DBUS_TYPE_INVALID))
-			throw(DbusTinyInternalException("error in dbus_message_append_args"));
+const DbusTinyStats &DbusTinyClient::get_stats()
+{
+	return(stats);
+}
 
-		serial = signal_serial++;
+void DbusTinyClient::send_async(DBusMessage *request_message, int milliseconds, DbusTinyCompletion &&completion)
+{
+	DBusPendingCall *pending_call;
+	async_context *context;
+	std::chrono::steady_clock::time_point expiry;
 
-		if(!dbus_connection_send(bus_connection, signal_message, &serial))
-			throw(DbusTinyInternalException("error in dbus_connection_send"));
+	pending_call = nullptr;
 
-	}
-	catch(const DbusTinyInternalException &e)
+	if(!dbus_connection_send_with_reply(bus_connection, request_message, &pending_call, milliseconds) || !pending_call)
 	{
-		std::string rv = std::string("signal_string: ") + e.what();
-
-		if(dbus_error_is_set(&dbus_error))
-		{
-			dbus_error_free(&dbus_error);
-			rv += std::string(" (dbus error: ") + dbus_error.message + ")";
-		}
+		if(pending_call)
+			dbus_pending_call_unref(pending_call);
 
-		if(signal_message)
-			dbus_message_unref(signal_message);
+		dbus_message_unref(request_message);
 
-		throw(DbusTinyException(rv));
+		throw(DbusTinyException("send: error in dbus_connection_send_with_reply"));
 	}
 
-	dbus_connection_flush(bus_connection);
-	dbus_message_unref(signal_message);
-}
+	dbus_message_unref(request_message);
 
-const std::string &DbusTinyClient::get_rv_string_0()
-{
-	return(rv_string_0);
-}
+	DbusTinyStats::add(stats.calls_sent);
 
-const std::string &DbusTinyClient::get_rv_string_1()
-{
-	return(rv_string_1);
-}
+	if(milliseconds < 0)
+		milliseconds = default_reply_timeout;
 
-const std::string &DbusTinyClient::get_rv_string_2()
-{
-	return(rv_string_2);
-}
+	if(milliseconds == DBUS_TIMEOUT_INFINITE)
+		expiry = std::chrono::steady_clock::time_point::max();
+	else
+		expiry = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
 
-uint64_t DbusTinyClient::get_rv_uint64_0()
-{
-	return(rv_uint64_0);
-}
+	context = new async_context{ this, std::move(completion), async_map::iterator() };
+	context->entry = async_calls.insert(std::make_pair(expiry, async_entry{ pending_call, context }));
 
-uint64_t DbusTinyClient::get_rv_uint64_1()
-{
-	return(rv_uint64_1);
-}
+	if(!dbus_pending_call_set_notify(pending_call, async_notify, context, async_free))
+	{
+		async_calls.erase(context->entry);
+		dbus_pending_call_cancel(pending_call);
+		dbus_pending_call_unref(pending_call);
+		delete context;
 
-uint64_t DbusTinyClient::get_rv_uint64_2()
-{
-	return(rv_uint64_2);
+		throw(DbusTinyException("send: error in dbus_pending_call_set_notify"));
+	}
 }
 
-uint32_t DbusTinyClient::get_rv_uint32_0()
+void DbusTinyClient::complete_async(async_context *context, DBusMessage *reply_message)
 {
-	return(rv_uint32_0);
-}
+	auto reply = std::make_shared<DbusTinyReply>(reply_message);
 
-uint32_t DbusTinyClient::get_rv_uint32_1()
-{
-	return(rv_uint32_1);
-}
+	if(!reply_message || dbus_message_is_error(reply_message, DBUS_ERROR_NO_REPLY))
+		DbusTinyStats::add(stats.timeouts);
 
-double DbusTinyClient::get_rv_double_0()
-{
-	return(rv_double_0);
-}
+	if(reply_message)
+		stats.received(reply_message);
 
-double DbusTinyClient::get_rv_double_1()
-{
-	return(rv_double_1);
+	try
+	{
+		if(executor)
+			executor([completion = context->completion, reply]() { completion(*reply); });
+		else
+			context->completion(*reply);
+	}
+	catch(...)
+	{
+		if(!async_exception)
+			async_exception = std::current_exception();
+	}
 }
 
-double DbusTinyClient::get_rv_double_2()
+void DbusTinyClient::async_notify(DBusPendingCall *pending_call, void *data)
 {
-	return(rv_double_2);
+	async_context *context = static_cast<async_context *>(data);
+	DbusTinyClient *client = context->client;
+
+	client->async_calls.erase(context->entry);
+	client->complete_async(context, dbus_pending_call_steal_reply(pending_call));
+
+	dbus_pending_call_unref(pending_call);
 }
 
-double DbusTinyClient::get_rv_double_3()
+void DbusTinyClient::async_free(void *data)
 {
-	return(rv_double_3);
+	delete static_cast<async_context *>(data);
 }
 
 bool DbusTinyClient::path_valid(const std::string &path)
@@ -666,7 +781,7 @@ bool DbusTinyClient::path_valid(const std::string &path)
 	if(path.find('.') != std::string::npos)
 		return(false);
 
-	return(true);
+	return(dbus_validate_path(path.c_str(), nullptr));
 }
 
 bool DbusTinyClient::domain_valid(const std::string &domain)
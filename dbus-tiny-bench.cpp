@@ -0,0 +1,440 @@
+#include <dbus-tiny.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <iostream>
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t members, size_t size);
+extern "C" void *__libc_realloc(void *pointer, size_t size);
+
+static std::atomic<uint64_t> allocations(0);
+
+void *malloc(size_t size) noexcept
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	return(__libc_malloc(size));
+}
+
+void *calloc(size_t members, size_t size) noexcept
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	return(__libc_calloc(members, size));
+}
+
+void *realloc(void *pointer, size_t size) noexcept
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	return(__libc_realloc(pointer, size));
+}
+
+static const std::string bench_service("dbus.tiny.bench");
+static const std::string bench_interface("dbus.tiny.bench");
+static const std::string bench_signal_interface("dbus.tiny.bench.signal");
+
+static const char *bench_daemon_config =
+	"<!DOCTYPE busconfig PUBLIC \"-//freedesktop//DTD D-Bus Bus Configuration 1.0//EN\" \"http://www.freedesktop.org/standards/dbus/1.0/busconfig.dtd\">\n"
+	"<busconfig>\n"
+	"	<type>session</type>\n"
+	"	<listen>unix:tmpdir=/tmp</listen>\n"
+	"	<auth>EXTERNAL</auth>\n"
+	"	<policy context=\"default\">\n"
+	"		<allow send_destination=\"*\" eavesdrop=\"true\"/>\n"
+	"		<allow eavesdrop=\"true\"/>\n"
+	"		<allow own=\"*\"/>\n"
+	"	</policy>\n"
+	"</busconfig>\n";
+
+static pid_t start_daemon(const std::string &daemon, std::string &config, std::string &address)
+{
+	char config_template[] = "/tmp/dbus-tiny-bench-XXXXXX";
+	int config_fd, address_pipe[2];
+	char buffer[256];
+	ssize_t length;
+	pid_t pid;
+
+	if((config_fd = mkstemp(config_template)) < 0)
+		throw("cannot create dbus-daemon configuration file");
+
+	config = config_template;
+
+	if(write(config_fd, bench_daemon_config, strlen(bench_daemon_config)) != static_cast<ssize_t>(strlen(bench_daemon_config)))
+		throw("cannot write dbus-daemon configuration file");
+
+	close(config_fd);
+
+	if(pipe(address_pipe))
+		throw("pipe failed");
+
+	if((pid = fork()) < 0)
+		throw("fork failed");
+
+	if(pid == 0)
+	{
+		close(address_pipe[0]);
+		execlp(daemon.c_str(), daemon.c_str(), "--nofork", (std::string("--config-file=") + config).c_str(),
+				(boost::format("--print-address=%d") % address_pipe[1]).str().c_str(), static_cast<const char *>(nullptr));
+		_exit(1);
+	}
+
+	close(address_pipe[1]);
+
+	address.clear();
+
+	while((length = read(address_pipe[0], buffer, sizeof(buffer))) > 0)
+	{
+		address.append(buffer, length);
+
+		if(address.find('\n') != std::string::npos)
+			break;
+	}
+
+	close(address_pipe[0]);
+
+	address = address.substr(0, address.find('\n'));
+
+	if(address.empty())
+		throw((boost::format("cannot start %s") % daemon).str());
+
+	return(pid);
+}
+
+static void run_server(DbusTinyBus bus_type, const std::string &address, bool flush_batching)
+{
+	DbusTinyMessageType message_type;
+	std::string_view message_interface;
+	std::string_view message_method;
+	bool quit = false;
+
+	DbusTinyServer dbus_server(bench_service, bus_type, address);
+
+	dbus_server.set_flush_batching(flush_batching);
+
+	dbus_server.add_method(bench_interface, "string_call_void", "", "s", [](DbusTinyRequest &request)
+	{
+		request.send_string("string-call-void OK");
+	});
+
+	dbus_server.add_method(bench_interface, "string_call_string", "s", "s", [](DbusTinyRequest &request)
+	{
+		request.receive_string();
+		request.send_string("string-call-string OK");
+	});
+
+	dbus_server.add_method(bench_interface, "call_x_1", "uuss", "tuusd", [](DbusTinyRequest &request)
+	{
+		uint32_t p0, p1;
+		std::string p2, p3;
+
+		request.receive_uint32_uint32_string_string(p0, p1, p2, p3);
+		request.send_uint64_uint32_uint32_string_double(p0, p1, 1, "call_x_1 OK", 123.456);
+	});
+
+	dbus_server.add_method(bench_interface, "call_x_2", "", "tsssdddd", [](DbusTinyRequest &request)
+	{
+		request.send_uint64_x3string_x4double(0, "string 1", "string 2", "string 3", 0.0, 1.1, 2.2, 3.3);
+	});
+
+	dbus_server.add_method(bench_interface, "call_x_3", "sss", "uttt", [](DbusTinyRequest &request)
+	{
+		std::string p0, p1, p2;
+
+		request.receive_x3string(p0, p1, p2);
+		request.send_uint32_x3uint64(0, 1, 2, 3);
+	});
+
+	dbus_server.add_method(bench_interface, "allocations", "", "t", [](DbusTinyRequest &request)
+	{
+		request.reply(allocations.load());
+	});
+
+	dbus_server.add_method(bench_interface, "quit", "", "", [&quit](DbusTinyRequest &)
+	{
+		quit = true;
+	});
+
+	dbus_server.register_signal(bench_signal_interface);
+
+	while(!quit)
+	{
+		dbus_server.get_message(message_type, message_interface, message_method);
+
+		if(message_type == DbusTinyMessageType::method_call)
+			if(!dbus_server.dispatch())
+				dbus_server.inform_error("unknown method");
+
+		dbus_server.reset();
+	}
+}
+
+static pid_t start_server(DbusTinyBus bus_type, const std::string &address, bool flush_batching)
+{
+	pid_t pid;
+
+	std::cout.flush();
+
+	if((pid = fork()) < 0)
+		throw("fork failed");
+
+	if(pid == 0)
+	{
+		try
+		{
+			run_server(bus_type, address, flush_batching);
+		}
+		catch(const DbusTinyException &e)
+		{
+			std::cerr << "dbus-tiny-bench: server: " << e.what() << std::endl;
+			_exit(1);
+		}
+
+		_exit(0);
+	}
+
+	return(pid);
+}
+
+static std::unique_ptr<DbusTinyClient> connect_client(DbusTinyBus bus_type, const std::string &address)
+{
+	std::unique_ptr<DbusTinyClient> dbus_client;
+
+	for(unsigned int attempt = 0;; attempt++)
+	{
+		try
+		{
+			if(!dbus_client)
+				dbus_client = std::make_unique<DbusTinyClient>(bus_type, address);
+
+			dbus_client->receive_string(dbus_client->send_void(bench_service, bench_interface, "string_call_void"));
+
+			return(dbus_client);
+		}
+		catch(const DbusTinyException &e)
+		{
+			if(attempt > 200)
+				throw((boost::format("cannot reach server: %s") % e.what()).str());
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+}
+
+static uint64_t server_allocations(DbusTinyClient &client)
+{
+	return(std::get<0>(client.call<uint64_t>(bench_service, bench_interface, "allocations")));
+}
+
+template<typename F> static void measure(const std::string &mode, const std::string &name, unsigned int iterations, DbusTinyClient &client, F call)
+{
+	std::vector<std::chrono::nanoseconds::rep> samples(iterations);
+	std::chrono::steady_clock::time_point start, call_start, end;
+	std::chrono::duration<double> duration;
+	uint64_t allocations_start, allocations_end;
+	uint64_t server_start, server_end, server_overhead;
+
+	for(unsigned int ix = 0; ix < (iterations / 10); ix++)
+		call();
+
+	server_start = server_allocations(client);
+	server_overhead = server_allocations(client) - server_start;
+	server_start += server_overhead;
+
+	allocations_start = allocations.load();
+	start = std::chrono::steady_clock::now();
+
+	for(unsigned int ix = 0; ix < iterations; ix++)
+	{
+		call_start = std::chrono::steady_clock::now();
+		call();
+		samples[ix] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - call_start).count();
+	}
+
+	end = std::chrono::steady_clock::now();
+	allocations_end = allocations.load();
+
+	server_end = server_allocations(client) - server_overhead;
+
+	duration = end - start;
+
+	std::sort(samples.begin(), samples.end());
+
+	auto percentile = [&samples](double fraction)
+	{
+		return(samples[std::min(samples.size() - 1, static_cast<size_t>(samples.size() * fraction))] / 1000.0);
+	};
+
+	std::cout << boost::format("mode=%s bench=%s calls=%u p50_us=%.1f p99_us=%.1f p999_us=%.1f calls_per_sec=%.0f allocs_per_call=%.1f allocs_per_reply=%.1f\n") %
+			mode % name % iterations % percentile(0.5) % percentile(0.99) % percentile(0.999) %
+			(iterations / duration.count()) % (static_cast<double>(allocations_end - allocations_start) / iterations) %
+			(static_cast<double>(server_end - server_start) / iterations);
+}
+
+static void run_client(const std::string &mode, DbusTinyBus bus_type, const std::string &address, unsigned int iterations)
+{
+	std::unique_ptr<DbusTinyClient> dbus_client = connect_client(bus_type, address);
+	DbusTinyClient &client = *dbus_client;
+	uint64_t r64_0;
+	uint32_t r32_0, r32_1, r32_2;
+	std::string rs_0, rs_1, rs_2;
+	double rd_0, rd_1, rd_2, rd_3;
+
+	measure(mode, "string_call_void", iterations, client, [&]()
+	{
+		client.receive_string(client.send_void(bench_service, bench_interface, "string_call_void"));
+	});
+
+	measure(mode, "string_call_string", iterations, client, [&]()
+	{
+		client.receive_string(client.send_string(bench_service, bench_interface, "string_call_string", "parameter"));
+	});
+
+	measure(mode, "call_x_1", iterations, client, [&]()
+	{
+		client.receive_uint64_uint32_uint32_string_double(client.send_uint32_uint32_string_string(bench_service, bench_interface, "call_x_1", 1, 2, "string 1", "string 2"),
+				r64_0, r32_0, r32_1, rs_0, rd_0);
+	});
+
+	measure(mode, "call_x_2", iterations, client, [&]()
+	{
+		client.receive_uint64_x3string_x4double(client.send_void(bench_service, bench_interface, "call_x_2"),
+				r64_0, rs_0, rs_1, rs_2, rd_0, rd_1, rd_2, rd_3);
+	});
+
+	measure(mode, "call_x_3", iterations, client, [&]()
+	{
+		client.receive_uint32_x3uint64(client.send_x3string(bench_service, bench_interface, "call_x_3", "string 1", "string 2", "string 3"),
+				r32_2, r64_0, r64_0, r64_0);
+	});
+
+	measure(mode, "signal_string", iterations, client, [&]()
+	{
+		client.signal_string("/", bench_signal_interface, "string_call_string", "parameter");
+	});
+
+	client.receive_string(client.send_void(bench_service, bench_interface, "string_call_void"));
+	client.send_void(bench_service, bench_interface, "quit");
+}
+
+static void run_mode(const std::string &mode, DbusTinyBus bus_type, const std::string &address, unsigned int iterations, bool flush_batching)
+{
+	pid_t server_pid;
+	int status;
+
+	server_pid = start_server(bus_type, address, flush_batching);
+
+	try
+	{
+		run_client(mode, bus_type, address, iterations);
+	}
+	catch(...)
+	{
+		kill(server_pid, SIGTERM);
+		waitpid(server_pid, &status, 0);
+		throw;
+	}
+
+	waitpid(server_pid, &status, 0);
+}
+
+int main(int argc, const char **argv)
+{
+	try
+	{
+		boost::program_options::options_description	options("usage");
+
+		try
+		{
+			unsigned int iterations = 10000;
+			bool bus_only = false;
+			bool peer_only = false;
+			bool flush_batching = false;
+			std::string daemon = "dbus-daemon";
+			std::string config;
+			std::string address;
+			pid_t daemon_pid;
+			int status;
+
+			options.add_options()
+				("iterations,n",	boost::program_options::value<unsigned int>(&iterations),					"calls per benchmark")
+				("daemon,d",		boost::program_options::value<std::string>(&daemon),						"dbus-daemon executable to launch")
+				("bus-only,b",		boost::program_options::bool_switch(&bus_only)->implicit_value(true),		"only run through a private dbus-daemon")
+				("peer-only,p",		boost::program_options::bool_switch(&peer_only)->implicit_value(true),		"only run peer-to-peer")
+				("flush-batching,f",	boost::program_options::bool_switch(&flush_batching)->implicit_value(true),	"batch reply flushes on the server");
+
+			boost::program_options::variables_map varmap;
+			boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(options).run(), varmap);
+			boost::program_options::notify(varmap);
+
+			if(iterations == 0)
+				throw("iterations must be at least 1");
+
+			if(!peer_only)
+			{
+				daemon_pid = start_daemon(daemon, config, address);
+
+				try
+				{
+					run_mode("bus", DbusTinyBus::address, address, iterations, flush_batching);
+				}
+				catch(...)
+				{
+					kill(daemon_pid, SIGTERM);
+					waitpid(daemon_pid, &status, 0);
+					unlink(config.c_str());
+					throw;
+				}
+
+				kill(daemon_pid, SIGTERM);
+				waitpid(daemon_pid, &status, 0);
+				unlink(config.c_str());
+			}
+
+			if(!bus_only)
+				run_mode("peer", DbusTinyBus::peer, (boost::format("unix:path=/tmp/dbus-tiny-bench-%d") % getpid()).str(), iterations, flush_batching);
+		}
+		catch(const boost::program_options::error &e)
+		{
+			throw((boost::format("program option exception: %s\n%s") % e.what() % options).str());
+		}
+		catch(const DbusTinyException &e)
+		{
+			throw((boost::format("error: %s") % e.what()).str());
+		}
+		catch(const std::exception &e)
+		{
+			throw((boost::format("standard exception: %s") % e.what()).str());
+		}
+		catch(const std::string &e)
+		{
+			throw((boost::format("error: %s ") % e).str());
+		}
+		catch(const char *e)
+		{
+			throw((boost::format("error: %s") % e).str());
+		}
+		catch(...)
+		{
+			throw(std::string("unknown exception"));
+		}
+	}
+	catch(const std::string &e)
+	{
+		std::cerr << "dbus-tiny-bench: " << e << std::endl;
+		return(1);
+	}
+
+	return(0);
+}
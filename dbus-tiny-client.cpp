@@ -1,6 +1,9 @@
 #include <dbus-tiny.h>
 
 #include <string>
+#include <vector>
+#include <utility>
+#include <chrono>
 #include <iostream>
 #include <boost/format.hpp>
 #include <boost/program_options.hpp>
@@ -15,6 +18,13 @@ int main(int argc, const char **argv)
 		try
 		{
 			bool introspect = false;
+			bool batch = false;
+			bool session = false;
+			bool peer = false;
+			DbusTinyBus bus_type;
+			std::string address;
+			unsigned int count = 1;
+			int timeout = -1;
 			std::string service;
 			std::string interface;
 			std::string rv1;
@@ -36,6 +46,12 @@ int main(int argc, const char **argv)
 				("call-x-2,2",				boost::program_options::value<std::string>(&call_x_2),					"call method taking void returning u64,3xstring,4xdouble")
 				("call-x-3,3",				boost::program_options::value<std::string>(&call_x_3),					"call method taking 3xstring returning u32,3xu64")
 				("signal-string,S",			boost::program_options::value<std::string>(&signal_string),				"send signal with string parameter")
+				("count,n",					boost::program_options::value<unsigned int>(&count),					"send signal this many times and report signals/sec")
+				("batch,b",					boost::program_options::bool_switch(&batch)->implicit_value(true),		"queue all signals and flush once")
+				("session,e",				boost::program_options::bool_switch(&session)->implicit_value(true),	"use the session bus instead of the system bus")
+				("address,a",				boost::program_options::value<std::string>(&address),					"connect to the bus at this address")
+				("peer,p",					boost::program_options::bool_switch(&peer)->implicit_value(true),		"connect directly to a peer server at the address")
+				("timeout,t",				boost::program_options::value<int>(&timeout),							"reply timeout in milliseconds")
 				("argument",				boost::program_options::value<std::vector<std::string>>(&arguments),	"specify method arguments");
 
 			positional_options.add("argument", -1);
@@ -44,7 +60,17 @@ int main(int argc, const char **argv)
 			boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(options).positional(positional_options).run(), varmap);
 			boost::program_options::notify(varmap);
 
-			DbusTinyClient dbus_client;
+			if(peer && address.empty())
+				throw(std::string("peer mode needs an address"));
+
+			if(!address.empty())
+				bus_type = peer ? DbusTinyBus::peer : DbusTinyBus::address;
+			else
+				bus_type = session ? DbusTinyBus::session : DbusTinyBus::system;
+
+			DbusTinyClient dbus_client(bus_type, address);
+
+			dbus_client.set_timeout(timeout);
 
 			if(service.length() == 0)
 				service = "/org/freedesktop/DBus/dummy";
@@ -133,7 +159,29 @@ int main(int argc, const char **argv)
 				if(arguments.size() != 1)
 					throw("signal-string needs one argument");
 
-				dbus_client.signal_string(service, interface, signal_string, arguments.at(0));
+				if(count == 1)
+					dbus_client.signal_string(service, interface, signal_string, arguments.at(0));
+				else
+				{
+					std::chrono::steady_clock::time_point start;
+					std::chrono::duration<double> duration;
+
+					start = std::chrono::steady_clock::now();
+
+					if(batch)
+					{
+						std::vector<std::pair<std::string, std::string>> signals(count, std::make_pair(signal_string, arguments.at(0)));
+
+						dbus_client.signal_string_batch(service, interface, signals);
+					}
+					else
+						for(unsigned int ix = 0; ix < count; ix++)
+							dbus_client.signal_string(service, interface, signal_string, arguments.at(0));
+
+					duration = std::chrono::steady_clock::now() - start;
+
+					std::cerr << boost::format("%u signals in %.3f s, %.0f signals/sec%s\n") % count % duration.count() % (count / duration.count()) % (batch ? " (batched)" : "");
+				}
 			}
 		}
 		catch(const boost::program_options::error &e)
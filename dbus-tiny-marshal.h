@@ -0,0 +1,557 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <dbus/dbus.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <variant>
+#include <cstddef>
+#include <compare>
+#include <type_traits>
+
+#include <dbus-tiny-stats.h>
+
+template<std::size_t N> struct DbusTinySignature
+{
+	char value[N + 1];
+
+	constexpr const char *c_str() const
+	{
+		return(value);
+	}
+};
+
+template<std::size_t A, std::size_t B> constexpr DbusTinySignature<A + B> operator +(const DbusTinySignature<A> &a, const DbusTinySignature<B> &b)
+{
+	DbusTinySignature<A + B> rv{};
+
+	for(std::size_t ix = 0; ix < A; ix++)
+		rv.value[ix] = a.value[ix];
+
+	for(std::size_t ix = 0; ix < B; ix++)
+		rv.value[A + ix] = b.value[ix];
+
+	rv.value[A + B] = '\0';
+
+	return(rv);
+}
+
+template<typename T> struct DbusTinyType;
+
+template<typename T> struct DbusTinyOwning : std::true_type {};
+template<> struct DbusTinyOwning<const char *> : std::false_type {};
+template<> struct DbusTinyOwning<char *> : std::false_type {};
+template<> struct DbusTinyOwning<std::string_view> : std::false_type {};
+template<typename T> struct DbusTinyOwning<std::vector<T>> : DbusTinyOwning<T> {};
+template<typename K, typename V> struct DbusTinyOwning<std::map<K, V>> : std::bool_constant<DbusTinyOwning<K>::value && DbusTinyOwning<V>::value> {};
+template<typename... T> struct DbusTinyOwning<std::tuple<T...>> : std::bool_constant<(DbusTinyOwning<T>::value && ...)> {};
+template<typename... T> struct DbusTinyOwning<std::variant<T...>> : std::bool_constant<(DbusTinyOwning<T>::value && ...)> {};
+
+class DbusTinyMarshal
+{
+	public:
+
+		template<typename... T> static constexpr auto signature()
+		{
+			return((DbusTinySignature<0>{ "" } + ... + DbusTinyType<std::decay_t<T>>::signature));
+		}
+
+		template<typename... T> static constexpr bool owning()
+		{
+			return((DbusTinyOwning<std::decay_t<T>>::value && ...));
+		}
+
+		template<typename... T> static constexpr bool has_fds()
+		{
+			for(char code : signature<T...>().value)
+				if(code == 'h')
+					return(true);
+
+			return(false);
+		}
+
+		template<typename... T> static bool can_send([[maybe_unused]] DBusConnection *connection)
+		{
+			if constexpr(has_fds<T...>())
+				return(dbus_connection_can_send_type(connection, DBUS_TYPE_UNIX_FD));
+			else
+				return(true);
+		}
+
+		template<typename... T> static bool append([[maybe_unused]] DBusMessageIter *iter, const T &... values)
+		{
+			return((DbusTinyType<std::decay_t<T>>::append(iter, values) && ...));
+		}
+
+		template<typename... T> static bool get([[maybe_unused]] DBusMessageIter *iter, T &... values)
+		{
+			return((get_next(iter, values) && ...));
+		}
+
+		template<typename... T> static bool append_message(DBusMessageIter *iter, const T &... values)
+		{
+			if constexpr(DbusTinyStats::enabled)
+			{
+				static constexpr auto name = DbusTinySignature<7>{ "append(" } + signature<T...>() + DbusTinySignature<1>{ ")" };
+				static DbusTinyHistogram &histogram = DbusTinyStats::marshal_histogram(name.c_str());
+				DbusTinyStatsTimer timer(histogram);
+
+				return(append(iter, values...));
+			}
+			else
+				return(append(iter, values...));
+		}
+
+		template<typename... T> static bool get_message(DBusMessageIter *iter, T &... values)
+		{
+			if constexpr(DbusTinyStats::enabled)
+			{
+				static constexpr auto name = DbusTinySignature<4>{ "get(" } + signature<T...>() + DbusTinySignature<1>{ ")" };
+				static DbusTinyHistogram &histogram = DbusTinyStats::marshal_histogram(name.c_str());
+				DbusTinyStatsTimer timer(histogram);
+
+				return(get(iter, values...));
+			}
+			else
+				return(get(iter, values...));
+		}
+
+	private:
+
+		template<typename T> static bool get_next(DBusMessageIter *iter, T &value)
+		{
+			if(!DbusTinyType<T>::get(iter, value))
+				return(false);
+
+			dbus_message_iter_next(iter);
+
+			return(true);
+		}
+};
+
+template<typename T, int dbus_type, char code> struct DbusTinyBasicType
+{
+	static constexpr DbusTinySignature<1> signature{ { code, '\0' } };
+	static constexpr int type = dbus_type;
+
+	static bool append(DBusMessageIter *iter, const T &value)
+	{
+		return(dbus_message_iter_append_basic(iter, dbus_type, &value));
+	}
+
+	static bool get(DBusMessageIter *iter, T &value)
+	{
+		if(dbus_message_iter_get_arg_type(iter) != dbus_type)
+			return(false);
+
+		dbus_message_iter_get_basic(iter, &value);
+
+		return(true);
+	}
+};
+
+template<> struct DbusTinyType<uint8_t> : DbusTinyBasicType<uint8_t, DBUS_TYPE_BYTE, 'y'> {};
+template<> struct DbusTinyType<int16_t> : DbusTinyBasicType<int16_t, DBUS_TYPE_INT16, 'n'> {};
+template<> struct DbusTinyType<uint16_t> : DbusTinyBasicType<uint16_t, DBUS_TYPE_UINT16, 'q'> {};
+template<> struct DbusTinyType<int32_t> : DbusTinyBasicType<int32_t, DBUS_TYPE_INT32, 'i'> {};
+template<> struct DbusTinyType<uint32_t> : DbusTinyBasicType<uint32_t, DBUS_TYPE_UINT32, 'u'> {};
+template<> struct DbusTinyType<int64_t> : DbusTinyBasicType<int64_t, DBUS_TYPE_INT64, 'x'> {};
+template<> struct DbusTinyType<uint64_t> : DbusTinyBasicType<uint64_t, DBUS_TYPE_UINT64, 't'> {};
+template<> struct DbusTinyType<double> : DbusTinyBasicType<double, DBUS_TYPE_DOUBLE, 'd'> {};
+
+template<> struct DbusTinyType<bool>
+{
+	static constexpr DbusTinySignature<1> signature{ "b" };
+
+	static bool append(DBusMessageIter *iter, const bool &value)
+	{
+		dbus_bool_t dbus_value = value;
+
+		return(dbus_message_iter_append_basic(iter, DBUS_TYPE_BOOLEAN, &dbus_value));
+	}
+
+	static bool get(DBusMessageIter *iter, bool &value)
+	{
+		dbus_bool_t dbus_value;
+
+		if(dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_BOOLEAN)
+			return(false);
+
+		dbus_message_iter_get_basic(iter, &dbus_value);
+		value = dbus_value;
+
+		return(true);
+	}
+};
+
+template<> struct DbusTinyType<const char *>
+{
+	static constexpr DbusTinySignature<1> signature{ "s" };
+
+	static bool append(DBusMessageIter *iter, const char * const &value)
+	{
+		return(dbus_message_iter_append_basic(iter, DBUS_TYPE_STRING, &value));
+	}
+
+	static bool get(DBusMessageIter *iter, const char *&value)
+	{
+		if(dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_STRING)
+			return(false);
+
+		dbus_message_iter_get_basic(iter, &value);
+
+		return(true);
+	}
+};
+
+template<> struct DbusTinyType<char *> : DbusTinyType<const char *> {};
+
+template<> struct DbusTinyType<std::string>
+{
+	static constexpr DbusTinySignature<1> signature{ "s" };
+
+	static bool append(DBusMessageIter *iter, const std::string &value)
+	{
+		const char *cstr = value.c_str();
+
+		return(dbus_message_iter_append_basic(iter, DBUS_TYPE_STRING, &cstr));
+	}
+
+	static bool get(DBusMessageIter *iter, std::string &value)
+	{
+		const char *cstr;
+
+		if(!DbusTinyType<const char *>::get(iter, cstr))
+			return(false);
+
+		value = cstr;
+
+		return(true);
+	}
+};
+
+template<> struct DbusTinyType<std::string_view>
+{
+	static constexpr DbusTinySignature<1> signature{ "s" };
+
+	static bool append(DBusMessageIter *iter, const std::string_view &value)
+	{
+		static thread_local std::string buffer;
+		const char *cstr;
+
+		if(value.find('\0') != std::string_view::npos)
+			return(false);
+
+		buffer.assign(value);
+		cstr = buffer.c_str();
+
+		return(dbus_message_iter_append_basic(iter, DBUS_TYPE_STRING, &cstr));
+	}
+
+	static bool get(DBusMessageIter *iter, std::string_view &value)
+	{
+		const char *cstr;
+
+		if(!DbusTinyType<const char *>::get(iter, cstr))
+			return(false);
+
+		value = cstr;
+
+		return(true);
+	}
+};
+
+struct DbusTinyCString
+{
+	DbusTinyCString(const char *value_in) : value(value_in)
+	{
+	}
+
+	DbusTinyCString(const std::string &value_in) : value(value_in.c_str())
+	{
+	}
+
+	const char *value;
+};
+
+template<> struct DbusTinyType<DbusTinyCString>
+{
+	static constexpr DbusTinySignature<1> signature{ "s" };
+
+	static bool append(DBusMessageIter *iter, const DbusTinyCString &value)
+	{
+		return(DbusTinyType<const char *>::append(iter, value.value));
+	}
+};
+
+struct DbusTinyObjectPath
+{
+	std::string path;
+
+	auto operator <=>(const DbusTinyObjectPath &) const = default;
+};
+
+template<> struct DbusTinyType<DbusTinyObjectPath>
+{
+	static constexpr DbusTinySignature<1> signature{ "o" };
+
+	static bool append(DBusMessageIter *iter, const DbusTinyObjectPath &value)
+	{
+		const char *cstr = value.path.c_str();
+
+		if(!dbus_validate_path(cstr, nullptr))
+			return(false);
+
+		return(dbus_message_iter_append_basic(iter, DBUS_TYPE_OBJECT_PATH, &cstr));
+	}
+
+	static bool get(DBusMessageIter *iter, DbusTinyObjectPath &value)
+	{
+		const char *cstr;
+
+		if(dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_OBJECT_PATH)
+			return(false);
+
+		dbus_message_iter_get_basic(iter, &cstr);
+		value.path = cstr;
+
+		return(true);
+	}
+};
+
+template<typename T> struct DbusTinyType<std::vector<T>>
+{
+	static constexpr auto signature = DbusTinySignature<1>{ "a" } + DbusTinyType<T>::signature;
+	static constexpr bool fixed = std::is_arithmetic_v<T> && !std::is_same_v<T, bool>;
+
+	static bool append(DBusMessageIter *iter, const std::vector<T> &value)
+	{
+		DBusMessageIter sub;
+
+		if(!dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY, DbusTinyType<T>::signature.c_str(), &sub))
+			return(false);
+
+		if constexpr(fixed)
+		{
+			const T *data = value.data();
+
+			if(!dbus_message_iter_append_fixed_array(&sub, DbusTinyType<T>::type, &data, static_cast<int>(value.size())))
+			{
+				dbus_message_iter_abandon_container(iter, &sub);
+				return(false);
+			}
+		}
+		else
+		{
+			for(const T &element : value)
+			{
+				if(!DbusTinyType<T>::append(&sub, element))
+				{
+					dbus_message_iter_abandon_container(iter, &sub);
+					return(false);
+				}
+			}
+		}
+
+		return(dbus_message_iter_close_container(iter, &sub));
+	}
+
+	static bool get(DBusMessageIter *iter, std::vector<T> &value)
+	{
+		DBusMessageIter sub;
+
+		if(dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_ARRAY)
+			return(false);
+
+		dbus_message_iter_recurse(iter, &sub);
+		value.clear();
+
+		if constexpr(fixed)
+		{
+			const T *data;
+			int length;
+
+			if(dbus_message_iter_get_element_type(iter) != DbusTinyType<T>::type)
+				return(false);
+
+			if(dbus_message_iter_get_arg_type(&sub) == DBUS_TYPE_INVALID)
+				return(true);
+
+			dbus_message_iter_get_fixed_array(&sub, &data, &length);
+			value.assign(data, data + length);
+		}
+		else
+		{
+			while(dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_INVALID)
+			{
+				value.emplace_back();
+
+				if(!DbusTinyType<T>::get(&sub, value.back()))
+					return(false);
+
+				dbus_message_iter_next(&sub);
+			}
+		}
+
+		return(true);
+	}
+};
+
+template<typename K, typename V> struct DbusTinyType<std::map<K, V>>
+{
+	static constexpr auto entry_signature = DbusTinySignature<1>{ "{" } + DbusTinyType<K>::signature + DbusTinyType<V>::signature + DbusTinySignature<1>{ "}" };
+	static constexpr auto signature = DbusTinySignature<1>{ "a" } + entry_signature;
+
+	static bool append(DBusMessageIter *iter, const std::map<K, V> &value)
+	{
+		DBusMessageIter sub, entry;
+
+		if(!dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY, entry_signature.c_str(), &sub))
+			return(false);
+
+		for(const auto &element : value)
+		{
+			if(!dbus_message_iter_open_container(&sub, DBUS_TYPE_DICT_ENTRY, nullptr, &entry))
+			{
+				dbus_message_iter_abandon_container(iter, &sub);
+				return(false);
+			}
+
+			if(!DbusTinyType<K>::append(&entry, element.first) || !DbusTinyType<V>::append(&entry, element.second) ||
+					!dbus_message_iter_close_container(&sub, &entry))
+			{
+				dbus_message_iter_abandon_container_if_open(&sub, &entry);
+				dbus_message_iter_abandon_container(iter, &sub);
+				return(false);
+			}
+		}
+
+		return(dbus_message_iter_close_container(iter, &sub));
+	}
+
+	static bool get(DBusMessageIter *iter, std::map<K, V> &value)
+	{
+		DBusMessageIter sub, entry;
+		K key;
+
+		if((dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_ARRAY) || (dbus_message_iter_get_element_type(iter) != DBUS_TYPE_DICT_ENTRY))
+			return(false);
+
+		dbus_message_iter_recurse(iter, &sub);
+		value.clear();
+
+		while(dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_INVALID)
+		{
+			dbus_message_iter_recurse(&sub, &entry);
+
+			if(!DbusTinyType<K>::get(&entry, key))
+				return(false);
+
+			dbus_message_iter_next(&entry);
+
+			if(!DbusTinyType<V>::get(&entry, value[key]))
+				return(false);
+
+			dbus_message_iter_next(&sub);
+		}
+
+		return(true);
+	}
+};
+
+template<typename... T> struct DbusTinyType<std::tuple<T...>>
+{
+	static constexpr auto signature = DbusTinySignature<1>{ "(" } + DbusTinyMarshal::signature<T...>() + DbusTinySignature<1>{ ")" };
+
+	static bool append(DBusMessageIter *iter, const std::tuple<T...> &value)
+	{
+		DBusMessageIter sub;
+
+		if(!dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, nullptr, &sub))
+			return(false);
+
+		if(!std::apply([&sub](const T &... elements) { return(DbusTinyMarshal::append(&sub, elements...)); }, value))
+		{
+			dbus_message_iter_abandon_container(iter, &sub);
+			return(false);
+		}
+
+		return(dbus_message_iter_close_container(iter, &sub));
+	}
+
+	static bool get(DBusMessageIter *iter, std::tuple<T...> &value)
+	{
+		DBusMessageIter sub;
+
+		if(dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_STRUCT)
+			return(false);
+
+		dbus_message_iter_recurse(iter, &sub);
+
+		return(std::apply([&sub](T &... elements) { return(DbusTinyMarshal::get(&sub, elements...)); }, value));
+	}
+};
+
+template<typename... T> struct DbusTinyType<std::variant<T...>>
+{
+	static constexpr DbusTinySignature<1> signature{ "v" };
+
+	static bool append(DBusMessageIter *iter, const std::variant<T...> &value)
+	{
+		return(std::visit([iter](const auto &element) { return(append_variant(iter, element)); }, value));
+	}
+
+	static bool get(DBusMessageIter *iter, std::variant<T...> &value)
+	{
+		DBusMessageIter sub;
+		std::string contained;
+		char *contained_signature;
+
+		if(dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_VARIANT)
+			return(false);
+
+		dbus_message_iter_recurse(iter, &sub);
+
+		if(!(contained_signature = dbus_message_iter_get_signature(&sub)))
+			return(false);
+
+		contained = contained_signature;
+		dbus_free(contained_signature);
+
+		return((get_variant<T>(&sub, contained, value) || ...));
+	}
+
+	private:
+
+		template<typename U> static bool append_variant(DBusMessageIter *iter, const U &element)
+		{
+			DBusMessageIter sub;
+
+			if(!dbus_message_iter_open_container(iter, DBUS_TYPE_VARIANT, DbusTinyType<U>::signature.c_str(), &sub))
+				return(false);
+
+			if(!DbusTinyType<U>::append(&sub, element))
+			{
+				dbus_message_iter_abandon_container(iter, &sub);
+				return(false);
+			}
+
+			return(dbus_message_iter_close_container(iter, &sub));
+		}
+
+		template<typename U> static bool get_variant(DBusMessageIter *iter, const std::string &contained, std::variant<T...> &value)
+		{
+			if(contained != DbusTinyType<U>::signature.c_str())
+				return(false);
+
+			return(DbusTinyType<U>::get(iter, value.template emplace<U>()));
+		}
+};
+
+typedef std::variant<bool, uint8_t, int16_t, uint16_t, int32_t, uint32_t, int64_t, uint64_t, double, std::string> DbusTinyVariant;
+typedef std::map<std::string, DbusTinyVariant> DbusTinyDict;
@@ -14,6 +14,10 @@ int main(int argc, const char **argv)
 
 		try
 		{
+			bool session = false;
+			bool peer = false;
+			DbusTinyBus bus_type;
+			std::string address;
 			std::string service;
 			std::string method_interface;
 			std::vector<std::string> signal_interface;
@@ -24,16 +28,72 @@ int main(int argc, const char **argv)
 			options.add_options()
 				("service,s",				boost::program_options::value<std::string>(&service)->required(),				"service to register")
 				("method-interface,i",		boost::program_options::value<std::string>(&method_interface)->required(),		"interface to use for registering methods")
-				("signal-interface,I",		boost::program_options::value<std::vector<std::string>>(&signal_interface),		"interfaces to use for registering signal");
+				("signal-interface,I",		boost::program_options::value<std::vector<std::string>>(&signal_interface),		"interfaces to use for registering signal")
+				("session,e",				boost::program_options::bool_switch(&session)->implicit_value(true),			"use the session bus instead of the system bus")
+				("address,a",				boost::program_options::value<std::string>(&address),							"connect to the bus at this address")
+				("peer,p",					boost::program_options::bool_switch(&peer)->implicit_value(true),				"listen on the address for a single peer instead of connecting to a bus");
 
 			boost::program_options::variables_map varmap;
 			boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(options).run(), varmap);
 			boost::program_options::notify(varmap);
 
-			DbusTinyServer dbus_server(service);
+			if(peer && address.empty())
+				throw(std::string("peer mode needs an address"));
+
+			if(!address.empty())
+				bus_type = peer ? DbusTinyBus::peer : DbusTinyBus::address;
+			else
+				bus_type = session ? DbusTinyBus::session : DbusTinyBus::system;
+
+			DbusTinyServer dbus_server(service, bus_type, address);
+
+			dbus_server.add_method(method_interface, "string_call_void", "", "s", [](DbusTinyRequest &request)
+			{
+				std::cout << "string_call_void method called\n";
+				request.send_string("string-call-void OK");
+			});
+
+			dbus_server.add_method(method_interface, "string_call_string", "s", "s", [](DbusTinyRequest &request)
+			{
+				std::cout << "string_call_string method called with parameters: " << request.receive_string() << std::endl;
+				request.send_string("string-call-string OK");
+			});
+
+			dbus_server.add_method(method_interface, "call_x_1", "uuss", "tuusd", [](DbusTinyRequest &request)
+			{
+				uint32_t p0, p1;
+				std::string p2, p3;
+
+				request.receive_uint32_uint32_string_string(p0, p1, p2, p3);
+
+				std::cout << "x_1 method called with parameters: " << p0 << " / " << p1 << " / " << p2 << " / " << p3 << std::endl;
+
+				request.send_uint64_uint32_uint32_string_double(time((time_t *)0), 0, 1, "call_x_1 OK", 123.456);
+			});
+
+			dbus_server.add_method(method_interface, "call_x_2", "", "tsssdddd", [](DbusTinyRequest &request)
+			{
+				std::cout << "x_2 method called\n";
+
+				request.send_uint64_x3string_x4double(time((time_t *)0), "string 1", "string 2", "string 3", 0.0, 1.1, 2.2, 3.3);
+			});
+
+			dbus_server.add_method(method_interface, "call_x_3", "sss", "uttt", [](DbusTinyRequest &request)
+			{
+				std::string p0, p1, p2;
+
+				request.receive_x3string(p0, p1, p2);
+
+				std::cout << "x_3 method called with parameters: " << p0 << " / " << p1 << " / " << p2 << std::endl;
+
+				request.send_uint32_x3uint64(0, 1, 2, time((time_t *)0));
+			});
 
 			for(auto &signal: signal_interface)
+			{
 				dbus_server.register_signal(signal);
+				dbus_server.add_signal(signal, "string_call_string", "s");
+			}
 
 			for(;;)
 			{
@@ -43,114 +103,8 @@ int main(int argc, const char **argv)
 
 				if(message_type == "method call")
 				{
-					if((message_interface == "org.freedesktop.DBus.Introspectable") && (message_method == "Introspect"))
-					{
-						std::string reply = std::string() +
-								"<!DOCTYPE node PUBLIC \"-//freedesktop//DTD D-BUS Object Introspection 1.0//EN\" \"http://www.freedesktop.org/standards/dbus/1.0/introspect.dtd\">\n" +
-								"<node>\n" +
-								"	<interface name=\"org.freedesktop.DBus.Introspectable\">\n" +
-								"		<method name=\"Introspect\">\n" +
-								"			<arg name=\"xml\" type=\"s\" direction=\"out\"/>\n" +
-								"		</method>\n" +
-								"	</interface>\n" +
-								"	<interface name=\"" + method_interface + "\">\n" +
-								"		<method name=\"string_call_void\">\n" +
-								"			<arg name=\"result\" type=\"s\" direction=\"out\"/>\n" +
-								"		</method>\n" +
-								"		<method name=\"string_call_string\">\n" +
-								"			<arg name=\"argument\" type=\"s\" direction=\"in\"/>\n" +
-								"			<arg name=\"result\" type=\"s\" direction=\"out\"/>\n" +
-								"		</method>\n" +
-								"		<method name=\"call_x_1\">\n" +
-								"			<arg name=\"argument_1\" type=\"u\" direction=\"in\"/>\n" +
-								"			<arg name=\"argument_2\" type=\"u\" direction=\"in\"/>\n" +
-								"			<arg name=\"argument_3\" type=\"s\" direction=\"in\"/>\n" +
-								"			<arg name=\"argument_4\" type=\"s\" direction=\"in\"/>\n" +
-								"			<arg name=\"reply_1\" type=\"t\" direction=\"out\"/>\n" +
-								"			<arg name=\"reply_2\" type=\"u\" direction=\"out\"/>\n" +
-								"			<arg name=\"reply_3\" type=\"u\" direction=\"out\"/>\n" +
-								"			<arg name=\"reply_4\" type=\"s\" direction=\"out\"/>\n" +
-								"			<arg name=\"reply_5\" type=\"d\" direction=\"out\"/>\n" +
-								"		</method>\n" +
-								"		<method name=\"call_x_2\">\n" +
-								"			<arg name=\"reply_1\" type=\"t\" direction=\"out\"/>\n" +
-								"			<arg name=\"reply_2\" type=\"u\" direction=\"out\"/>\n" +
-								"			<arg name=\"reply_3\" type=\"u\" direction=\"out\"/>\n" +
-								"			<arg name=\"reply_4\" type=\"s\" direction=\"out\"/>\n" +
-								"			<arg name=\"reply_5\" type=\"d\" direction=\"out\"/>\n" +
-								"			<arg name=\"reply_6\" type=\"d\" direction=\"out\"/>\n" +
-								"			<arg name=\"reply_7\" type=\"d\" direction=\"out\"/>\n" +
-								"			<arg name=\"reply_8\" type=\"d\" direction=\"out\"/>\n" +
-								"		</method>\n" +
-								"		<method name=\"call_x_3\">\n" +
-								"			<arg name=\"argument_1\" type=\"s\" direction=\"in\"/>\n" +
-								"			<arg name=\"argument_2\" type=\"s\" direction=\"in\"/>\n" +
-								"			<arg name=\"argument_3\" type=\"s\" direction=\"in\"/>\n" +
-								"			<arg name=\"reply_1\" type=\"u\" direction=\"out\"/>\n" +
-								"			<arg name=\"reply_2\" type=\"t\" direction=\"out\"/>\n" +
-								"			<arg name=\"reply_3\" type=\"t\" direction=\"out\"/>\n" +
-								"			<arg name=\"reply_4\" type=\"t\" direction=\"out\"/>\n" +
-								"		</method>\n" +
-								"	</interface>\n";
-
-						for(const auto &signal : signal_interface)
-						{
-							reply += std::string() +
-								"	<interface name=\"" + signal + "\">\n" +
-								"		<signal name=\"string_call_string\">\n" +
-								"			<arg name=\"argument\" type=\"s\"/>\n" +
-								"		</signal>\n" +
-								"	</interface>\n";
-						}
-
-						reply += "</node>\n";
-
-						dbus_server.send_string(reply);
-					}
-					else if((message_interface == method_interface) || (message_interface == ""))
-					{
-						if(message_method == "string_call_void")
-						{
-							std::cout << "string_call_void method called\n";
-							dbus_server.send_string("string-call-void OK");
-						}
-						else if(message_method == "string_call_string")
-						{
-							std::cout << "string_call_string method called with parameters: " << dbus_server.receive_string() << std::endl;
-							dbus_server.send_string("string-call-string OK");
-						}
-						else if(message_method == "call_x_1")
-						{
-							uint32_t p0, p1;
-							std::string p2, p3;
-
-							dbus_server.receive_uint32_uint32_string_string(p0, p1, p2, p3);
-
-							std::cout << "x_1 method called with parameters: " << p0 << " / " << p1 << " / " << p2 << " / " << p3 << std::endl;
-
-							dbus_server.send_uint64_uint32_uint32_string_double(time((time_t *)0), 0, 1, "call_x_1 OK", 123.456);
-						}
-						else if(message_method == "call_x_2")
-						{
-							std::cout << "x_2 method called\n";
-
-							dbus_server.send_uint64_x3string_x4double(time((time_t *)0), "string 1", "string 2", "string 3", 0.0, 1.1, 2.2, 3.3);
-						}
-						else if(message_method == "call_x_3")
-						{
-							std::string p0, p1, p2;
-
-							dbus_server.receive_x3string(p0, p1, p2);
-
-							std::cout << "x_3 method called with parameters: " << p0 << " / " << p1 << " / " << p2 << std::endl;
-
-							dbus_server.send_uint32_x3uint64(0, 1, 2, time((time_t *)0));
-						}
-						else
-							dbus_server.inform_error("unknown method");
-					}
-					else
-						dbus_server.inform_error("unknown interface");
+					if(!dbus_server.dispatch())
+						dbus_server.inform_error("unknown method");
 				}
 				else if(message_type == "method reply")
 				{
@@ -36,9 +36,19 @@ $method_interface = "" if(!defined($method_interface));
 
 my($dbus_server) = new DBUS::Tiny::DbusTinyServer($service);
 
+if($method_interface ne "")
+{
+	$dbus_server->add_method($method_interface, "string_call_void", "", "s");
+	$dbus_server->add_method($method_interface, "string_call_string", "s", "s");
+	$dbus_server->add_method($method_interface, "call_x_1", "uuss", "tuusd");
+	$dbus_server->add_method($method_interface, "call_x_2", "", "tsssdddd");
+	$dbus_server->add_method($method_interface, "call_x_3", "sss", "uttt");
+}
+
 foreach $signal (@signal_interface)
 {
 	$dbus_server->register_signal($signal);
+	$dbus_server->add_signal($signal, "string_call_string", "s");
 }
 
 for(;;)
@@ -56,67 +66,7 @@ for(;;)
 		{
 			if(($message_interface eq "org.freedesktop.DBus.Introspectable") && ($message_method eq "Introspect"))
 			{
-				my($reply) =
-						"<!DOCTYPE node PUBLIC \"-//freedesktop//DTD D-BUS Object Introspection 1.0//EN\" \"http://www.freedesktop.org/standards/dbus/1.0/introspect.dtd\">\n" .
-						"<node>\n" .
-						"	<interface name=\"org.freedesktop.DBus.Introspectable\">\n" .
-						"		<method name=\"Introspect\">\n" .
-						"			<arg name=\"xml\" type=\"s\" direction=\"out\"/>\n" .
-						"		</method>\n" .
-						"	</interface>\n" .
-						"	<interface name=\"" . $method_interface . "\">\n" .
-						"		<method name=\"string_call_void\">\n" .
-						"			<arg name=\"reply\" type=\"s\" direction=\"out\"/>\n" .
-						"		</method>\n" .
-						"		<method name=\"string_call_string\">\n" .
-						"			<arg name=\"argument\" type=\"s\" direction=\"in\"/>\n" .
-						"			<arg name=\"reply\" type=\"s\" direction=\"out\"/>\n" .
-						"		</method>\n" .
-						"		<method name=\"call_x_1\">\n" .
-						"			<arg name=\"argument_1\" type=\"u\" direction=\"in\"/>\n" .
-						"			<arg name=\"argument_2\" type=\"u\" direction=\"in\"/>\n" .
-						"			<arg name=\"argument_3\" type=\"s\" direction=\"in\"/>\n" .
-						"			<arg name=\"argument_4\" type=\"s\" direction=\"in\"/>\n" .
-						"			<arg name=\"reply_1\" type=\"t\" direction=\"out\"/>\n" .
-						"			<arg name=\"reply_2\" type=\"u\" direction=\"out\"/>\n" .
-						"			<arg name=\"reply_3\" type=\"u\" direction=\"out\"/>\n" .
-						"			<arg name=\"reply_4\" type=\"s\" direction=\"out\"/>\n" .
-						"			<arg name=\"reply_5\" type=\"d\" direction=\"out\"/>\n" .
-						"		</method>\n" .
-						"		<method name=\"call_x_2\">\n" .
-						"			<arg name=\"reply_1\" type=\"t\" direction=\"out\"/>\n" .
-						"			<arg name=\"reply_2\" type=\"u\" direction=\"out\"/>\n" .
-						"			<arg name=\"reply_3\" type=\"u\" direction=\"out\"/>\n" .
-						"			<arg name=\"reply_4\" type=\"s\" direction=\"out\"/>\n" .
-						"			<arg name=\"reply_5\" type=\"d\" direction=\"out\"/>\n" .
-						"			<arg name=\"reply_6\" type=\"d\" direction=\"out\"/>\n" .
-						"			<arg name=\"reply_7\" type=\"d\" direction=\"out\"/>\n" .
-						"			<arg name=\"reply_8\" type=\"d\" direction=\"out\"/>\n" .
-						"		</method>\n" .
-						"		<method name=\"call_x_3\">\n" .
-						"			<arg name=\"argument_1\" type=\"s\" direction=\"in\"/>\n" .
-						"			<arg name=\"argument_2\" type=\"s\" direction=\"in\"/>\n" .
-						"			<arg name=\"argument_3\" type=\"s\" direction=\"in\"/>\n" .
-						"			<arg name=\"reply_1\" type=\"u\" direction=\"out\"/>\n" .
-						"			<arg name=\"reply_2\" type=\"t\" direction=\"out\"/>\n" .
-						"			<arg name=\"reply_3\" type=\"t\" direction=\"out\"/>\n" .
-						"			<arg name=\"reply_4\" type=\"t\" direction=\"out\"/>\n" .
-						"		</method>\n" .
-						"	</interface>\n";
-
-				foreach $signal (@signal_interface)
-				{
-					$reply .=
-						"	<interface name=\"" . $signal . "\">\n" .
-						"		<signal name=\"string_call_string\">\n" .
-						"			<arg name=\"argument\" type=\"s\"/>\n" .
-						"		</signal>\n" .
-						"	</interface>\n";
-				}
-
-				$reply .= "</node>\n";
-
-				$dbus_server->send_string($reply);
+				$dbus_server->send_string($dbus_server->get_introspection());
 			}
 			elsif(($message_interface eq $method_interface) || ($message_interface eq ""))
 			{
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+#include <dbus/dbus.h>
+
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <string>
+#include <map>
+
+class DbusTinyHistogram
+{
+	public:
+
+		static constexpr unsigned int buckets = 48;
+
+		DbusTinyHistogram(const DbusTinyHistogram &) = delete;
+
+		DbusTinyHistogram();
+
+		void record(std::chrono::steady_clock::duration elapsed);
+		uint64_t get_count() const;
+		uint64_t get_sum_ns() const;
+		uint64_t get_percentile_ns(double percentile) const;
+		void values(const std::string &name, std::map<std::string, uint64_t> &rv) const;
+
+	private:
+
+		std::array<std::atomic<uint64_t>, buckets> counts;
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> sum_ns;
+};
+
+class DbusTinyStats
+{
+	public:
+
+#ifdef DBUS_TINY_STATS
+		static constexpr bool enabled = true;
+#else
+		static constexpr bool enabled = false;
+#endif
+
+		DbusTinyStats(const DbusTinyStats &) = delete;
+
+		DbusTinyStats();
+
+		static void add(std::atomic<uint64_t> &counter)
+		{
+			if constexpr(enabled)
+				counter.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void received(DBusMessage *message);
+		std::map<std::string, uint64_t> values() const;
+
+		static DbusTinyHistogram &marshal_histogram(const char *name);
+
+		std::atomic<uint64_t> method_calls_received;
+		std::atomic<uint64_t> method_returns_received;
+		std::atomic<uint64_t> errors_received;
+		std::atomic<uint64_t> signals_received;
+		std::atomic<uint64_t> signals_dropped;
+		std::atomic<uint64_t> calls_sent;
+		std::atomic<uint64_t> replies_sent;
+		std::atomic<uint64_t> errors_sent;
+		std::atomic<uint64_t> signals_sent;
+		std::atomic<uint64_t> timeouts;
+		std::atomic<uint64_t> flushes;
+		std::atomic<uint64_t> calls_shed;
+		std::atomic<uint64_t> signals_shed;
+
+		DbusTinyHistogram wait;
+		DbusTinyHistogram handler;
+};
+
+class DbusTinyStatsTimer
+{
+	public:
+
+		DbusTinyStatsTimer() = delete;
+		DbusTinyStatsTimer(const DbusTinyStatsTimer &) = delete;
+
+		DbusTinyStatsTimer(DbusTinyHistogram &histogram_in) : histogram(histogram_in)
+		{
+			if constexpr(DbusTinyStats::enabled)
+				start = std::chrono::steady_clock::now();
+		}
+
+		~DbusTinyStatsTimer()
+		{
+			if constexpr(DbusTinyStats::enabled)
+				histogram.record(std::chrono::steady_clock::now() - start);
+		}
+
+	private:
+
+		DbusTinyHistogram &histogram;
+		std::chrono::steady_clock::time_point start;
+};
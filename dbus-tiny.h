@@ -2,12 +2,31 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <poll.h>
 #include <dbus/dbus.h>
 
 #include <exception>
 #include <string>
+#include <string_view>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <tuple>
+#include <exception>
+#include <deque>
+#include <coroutine>
 #include <boost/format.hpp>
 
+#ifndef SWIG
+#include <dbus-tiny-marshal.h>
+#endif
+
 class DbusTinyException : public std::exception
 {
 	public:
@@ -40,6 +59,281 @@ class DbusTinyInternalException : public std::exception
 		const std::string what_string;
 };
 
+#ifndef SWIG
+enum class DbusTinyMessageType
+{
+	method_call,
+	method_return,
+	error,
+	signal,
+	unknown,
+};
+
+enum class DbusTinyStatus
+{
+	ok,
+	timeout,
+	error,
+};
+
+enum class DbusTinyBus
+{
+	system,
+	session,
+	address,
+	peer,
+};
+
+enum class DbusTinyOverload
+{
+	block,
+	shed,
+};
+
+class DbusTinyFd
+{
+	public:
+
+		DbusTinyFd(const DbusTinyFd &) = delete;
+
+		DbusTinyFd();
+		explicit DbusTinyFd(int fd);
+		DbusTinyFd(DbusTinyFd &&);
+		DbusTinyFd &operator =(DbusTinyFd &&);
+		~DbusTinyFd();
+
+		static DbusTinyFd sealed(const std::string &name, const void *payload, size_t size);
+		static DbusTinyFd sealed(const std::string &name, const std::string &payload);
+
+		int get() const;
+		int release();
+		void reset(int fd = -1);
+
+	private:
+
+		int fd;
+};
+
+class DbusTinyMapping
+{
+	public:
+
+		DbusTinyMapping() = delete;
+		DbusTinyMapping(const DbusTinyMapping &) = delete;
+
+		DbusTinyMapping(const DbusTinyFd &fd);
+		~DbusTinyMapping();
+
+		const void *data() const;
+		size_t size() const;
+		std::string_view view() const;
+
+	private:
+
+		void *address;
+		size_t length;
+};
+
+class DbusTinyResult
+{
+	public:
+
+		DbusTinyResult(const DbusTinyResult &) = delete;
+
+		DbusTinyResult();
+		DbusTinyResult(DbusTinyStatus status, const char *name, const char *text);
+		DbusTinyResult(DBusMessage *error_message);
+		DbusTinyResult(DbusTinyResult &&other) noexcept;
+		DbusTinyResult &operator =(DbusTinyResult &&other) noexcept;
+		~DbusTinyResult();
+
+		explicit operator bool() const;
+		bool ok() const;
+		DbusTinyStatus get_status() const;
+		std::string_view get_error_name() const;
+		std::string_view get_error_message() const;
+		[[noreturn]] void raise(const char *prefix) const;
+
+	private:
+
+		DbusTinyStatus status;
+		DBusMessage *message;
+		const char *name;
+		const char *text;
+};
+
+class DbusTinyPreparedCall
+{
+	public:
+
+		DbusTinyPreparedCall() = delete;
+		DbusTinyPreparedCall(const DbusTinyPreparedCall &) = delete;
+
+		DbusTinyPreparedCall(const std::string &service, const std::string &interface, const std::string &method, const std::string &path = "/");
+		DbusTinyPreparedCall(DbusTinyPreparedCall &&other) noexcept;
+		~DbusTinyPreparedCall();
+
+		DBusMessage *new_message() const;
+
+	private:
+
+		DBusMessage *message;
+};
+#endif
+
+class DbusTinyRequest
+{
+	public:
+
+		DbusTinyRequest(const DbusTinyRequest &) = delete;
+
+		DbusTinyRequest();
+#ifndef SWIG
+		DbusTinyRequest(DbusTinyRequest &&);
+		DbusTinyRequest &operator =(DbusTinyRequest &&);
+#endif
+		~DbusTinyRequest();
+
+		void set(DBusConnection *connection, DBusMessage *message);
+#ifndef SWIG
+		void set(DBusConnection *connection, DBusMessage *message, DbusTinyStats *stats);
+#endif
+		void reset();
+		bool pending();
+		bool has_replied();
+		bool has_signature(const std::string &signature);
+
+		const std::string &receive_string();
+		void receive_uint32_uint32_string_string(uint32_t &, uint32_t &, std::string &, std::string &);
+		void receive_uint32_uint32_string_string_swig();
+		void receive_x3string(std::string &, std::string &, std::string &);
+		void receive_x3string_swig();
+#ifdef SWIG
+		void send_string(const std::string &reply_string);
+		void send_uint64_uint32_uint32_string_double(uint64_t, uint32_t, uint32_t, const std::string &, double);
+		void send_uint64_x3string_x4double(uint64_t, const std::string &, const std::string &, const std::string &, double, double, double, double);
+#else
+		void send_string(DbusTinyCString reply_string);
+		void send_uint64_uint32_uint32_string_double(uint64_t, uint32_t, uint32_t, DbusTinyCString, double);
+		void send_uint64_x3string_x4double(uint64_t, DbusTinyCString, DbusTinyCString, DbusTinyCString, double, double, double, double);
+#endif
+		void send_uint32_x3uint64(uint32_t, uint64_t, uint64_t, uint64_t);
+		const std::string &inform_error(const std::string &reason);
+#ifndef SWIG
+		template<typename... R> void receive(R &... rv);
+		template<typename... A> void reply(const A &... args);
+		DbusTinyResult reply_error(const char *name, const char *text);
+#endif
+
+		const std::string &get_message_type();
+		const std::string &get_message_interface();
+		const std::string &get_message_method();
+		const std::string &get_message_path();
+#ifndef SWIG
+		DbusTinyMessageType get_type();
+		std::string_view get_interface();
+		std::string_view get_method();
+		std::string_view get_path();
+#endif
+
+		uint32_t get_rv_uint32_0();
+		uint32_t get_rv_uint32_1();
+		const std::string &get_rv_string_0();
+		const std::string &get_rv_string_1();
+		const std::string &get_rv_string_2();
+
+	private:
+
+		friend class DbusTinyServer;
+
+		void decode_message();
+		DBusMessage *new_reply();
+		void send_reply(DBusMessage *reply_message);
+		[[noreturn]] void append_failed(DBusMessage *reply_message);
+		[[noreturn]] void fds_unsupported(DBusMessage *reply_message);
+		[[noreturn]] void receive_failed(const char *signature);
+
+		DBusError dbus_error;
+		DBusConnection *connection;
+		DBusMessage *message;
+#ifndef SWIG
+		DbusTinyStats *stats;
+#endif
+		bool decoded;
+		bool replied;
+
+		std::string message_type;
+		std::string message_interface;
+		std::string message_method;
+		std::string message_path;
+		std::string message_string_reply_0;
+
+		uint32_t rv_uint32_0;
+		uint32_t rv_uint32_1;
+		std::string rv_string_0;
+		std::string rv_string_1;
+		std::string rv_string_2;
+};
+
+#ifndef SWIG
+typedef std::function<void(DbusTinyRequest &)> DbusTinyHandler;
+
+struct DbusTinyMatch
+{
+	std::string sender;
+	std::string path;
+	std::string path_namespace;
+	std::string interface;
+	std::string member;
+	std::map<unsigned int, std::string> args;
+	std::string arg0_namespace;
+
+	bool operator ==(const DbusTinyMatch &) const = default;
+};
+
+class DbusTinyServer;
+class DbusTinyClient;
+
+class DbusTinyTask
+{
+	public:
+
+		struct promise_type
+		{
+			DbusTinyTask get_return_object();
+			std::suspend_never initial_suspend() noexcept;
+			std::suspend_never final_suspend() noexcept;
+			void return_void();
+			void unhandled_exception();
+		};
+
+		static void rethrow_unhandled();
+
+	private:
+
+		static thread_local std::exception_ptr unhandled;
+};
+
+class DbusTinyMessageAwaiter
+{
+	public:
+
+		DbusTinyMessageAwaiter() = delete;
+		DbusTinyMessageAwaiter(const DbusTinyMessageAwaiter &) = delete;
+
+		DbusTinyMessageAwaiter(DbusTinyServer &server);
+
+		bool await_ready();
+		void await_suspend(std::coroutine_handle<> handle);
+		DbusTinyRequest await_resume();
+
+	private:
+
+		DbusTinyServer &server;
+		DbusTinyRequest request;
+};
+#endif
+
 class DbusTinyServer
 {
 	public:
@@ -48,26 +342,85 @@ class DbusTinyServer
 		DbusTinyServer(const DbusTinyServer &) = delete;
 
 		DbusTinyServer(const std::string &bus);
+#ifndef SWIG
+		DbusTinyServer(const std::string &bus, DbusTinyBus bus_type, const std::string &address = "");
+#endif
 		~DbusTinyServer();
 
 		void register_signal(const std::string &interface);
+#ifndef SWIG
+		void register_signal(const DbusTinyMatch &match);
+		void unregister_signal(const DbusTinyMatch &match);
+#endif
 		void get_message(std::string &type, std::string &interface, std::string &method);
 		void get_message_swig();
+		bool try_get_message(std::string &type, std::string &interface, std::string &method);
+		bool try_get_message_swig();
+#ifndef SWIG
+		void get_message(DbusTinyMessageType &type, std::string_view &interface, std::string_view &method);
+		bool try_get_message(DbusTinyMessageType &type, std::string_view &interface, std::string_view &method);
+		unsigned int get_messages(unsigned int max, std::vector<DbusTinyRequest> &requests);
+		// includes the internal wakeup eventfd, pass the polled set back to dispatch_ready
+		void get_poll_fds(std::vector<struct pollfd> &fds);
+		int get_poll_timeout();
+		void dispatch_ready(const std::vector<struct pollfd> &fds);
+#endif
 		const std::string &receive_string();
 		void receive_uint32_uint32_string_string(uint32_t &, uint32_t &, std::string &, std::string &);
 		void receive_uint32_uint32_string_string_swig();
 		void receive_x3string(std::string &, std::string &, std::string &);
 		void receive_x3string_swig();
+#ifdef SWIG
 		void send_string(const std::string &reply_string);
 		void send_uint64_uint32_uint32_string_double(uint64_t, uint32_t, uint32_t, const std::string &, double);
 		void send_uint64_x3string_x4double(uint64_t, const std::string &, const std::string &, const std::string &, double, double, double, double);
+#else
+		void send_string(DbusTinyCString reply_string);
+		void send_uint64_uint32_uint32_string_double(uint64_t, uint32_t, uint32_t, DbusTinyCString, double);
+		void send_uint64_x3string_x4double(uint64_t, DbusTinyCString, DbusTinyCString, DbusTinyCString, double, double, double, double);
+#endif
 		void send_uint32_x3uint64(uint32_t, uint64_t, uint64_t, uint64_t);
 		const std::string &inform_error(const std::string &reason);
 		void reset();
+		void set_flush_batching(bool enable, unsigned int messages = 64, unsigned int bytes = 65536, unsigned int delay_us = 1000);
+		void set_max_received_size(long bytes);
+#ifndef SWIG
+		void set_queue_limit(unsigned int high_watermark, DbusTinyOverload policy = DbusTinyOverload::block);
+		template<typename... R> void receive(R &... rv)
+		{
+			request.receive(rv...);
+		}
+
+		template<typename... A> void reply(const A &... args)
+		{
+			request.reply(args...);
+		}
+
+		void run_workers(unsigned int threads, const DbusTinyHandler &handler);
+		void add_method(const std::string &interface, const std::string &method, const std::string &in_signature, const std::string &out_signature,
+				const DbusTinyHandler &handler);
+		void add_object(const std::string &path, bool fallback, const DbusTinyHandler &handler);
+		bool dispatch(DbusTinyRequest &request);
+		DbusTinyMessageAwaiter next_message();
+		bool resume_waiters();
+		void run_coroutines(const std::vector<DbusTinyClient *> &clients = {});
+		const DbusTinyStats &get_stats();
+#endif
+		void run_workers(unsigned int threads);
+		void stop();
+		void add_method(const std::string &interface, const std::string &method, const std::string &in_signature, const std::string &out_signature);
+		void add_signal(const std::string &interface, const std::string &signal, const std::string &signature);
+		void add_object(const std::string &path, bool fallback = false);
+		void remove_object(const std::string &path);
+		void add_stats_method(const std::string &interface);
+		const std::string &get_introspection();
+		std::string get_introspection(const std::string &path);
+		bool dispatch();
 
 		const std::string &get_message_type();
 		const std::string &get_message_interface();
 		const std::string &get_message_method();
+		const std::string &get_message_path();
 
 		uint32_t get_rv_uint32_0();
 		uint32_t get_rv_uint32_1();
@@ -77,24 +430,214 @@ class DbusTinyServer
 
 	private:
 
+		struct registry_method
+		{
+			std::string in_signature;
+			std::string out_signature;
+#ifndef SWIG
+			DbusTinyHandler handler;
+#endif
+		};
+
+		struct registry_interface
+		{
+			std::map<std::string, registry_method> methods;
+			std::map<std::string, std::string> signals;
+		};
+
+		struct dispatch_slot
+		{
+			uint64_t hash;
+			const char *interface;
+			const char *method;
+			const registry_method *entry;
+		};
+
+#ifndef SWIG
+		struct string_hash
+		{
+			typedef void is_transparent;
+
+			size_t operator ()(std::string_view segment) const
+			{
+				return(std::hash<std::string_view>()(segment));
+			}
+		};
+
+		struct object_node
+		{
+			std::unordered_map<std::string, std::unique_ptr<object_node>, string_hash, std::equal_to<>> children;
+			bool object = false;
+			bool fallback = false;
+			DbusTinyHandler handler;
+		};
+#endif
+
+#ifndef SWIG
+		friend class DbusTinyMessageAwaiter;
+
+		struct message_waiter
+		{
+			std::coroutine_handle<> handle;
+			DbusTinyRequest *request;
+		};
+#endif
+
+		static dbus_bool_t add_watch(DBusWatch *watch, void *data);
+		static void remove_watch(DBusWatch *watch, void *data);
+		static void toggle_watch(DBusWatch *watch, void *data);
+		static dbus_bool_t add_timeout(DBusTimeout *timeout, void *data);
+		static void remove_timeout(DBusTimeout *timeout, void *data);
+		static void toggle_timeout(DBusTimeout *timeout, void *data);
+		static void wakeup_main(void *data);
+		static void new_connection(DBusServer *listener, DBusConnection *connection, void *data);
+
+		int get_timeout_remaining();
+		int poll_ready(std::vector<struct pollfd> &fds, int timeout);
+		void accept_peer(const std::string &address);
+		void release_connection();
+		DBusMessage *read_message();
+		DBusMessage *pop_message();
+		bool shed_message(DBusMessage *message);
+		void check_unlimited(const char *caller);
+		void flush();
+		void flush_due();
+#ifndef SWIG
+		std::string match_rule(const DbusTinyMatch &match);
+		bool signal_wanted(DBusMessage *message);
+		bool signal_matches(DBusMessage *message, const DbusTinyMatch &match);
+#endif
+		void introspect_arguments(std::string &xml, const std::string &signature, const char *name, const char *direction);
+		void build_dispatch_table();
+		void insert_dispatch_slot(const char *interface, const char *method, const registry_method *entry);
+		const dispatch_slot *find_dispatch_slot(const char *interface, const char *method);
+		void dispatch_error(DbusTinyRequest &dispatch_request, const char *name, const char *reason);
+#ifndef SWIG
+		const object_node *find_object(std::string_view path, const object_node *&fallback);
+		const std::string &introspect_object(const object_node *node, bool object);
+		void invalidate_introspection();
+#endif
+
 		DBusError dbus_error;
 		DBusConnection *bus_connection;
-		DBusMessage *pending_message;
+		DbusTinyBus bus_type;
+		DbusTinyRequest request;
 
-		std::string message_type;
-		std::string message_interface;
-		std::string message_method;
-		std::string message_string_reply_0;
-		std::string message_string_reply_1;
-		std::string message_string_reply_2;
+		std::mutex watch_mutex;
+		std::vector<DBusWatch *> watches;
+		std::map<DBusTimeout *, std::chrono::steady_clock::time_point> timeouts;
 
-		uint32_t rv_uint32_0;
-		uint32_t rv_uint32_1;
-		std::string rv_string_0;
-		std::string rv_string_1;
-		std::string rv_string_2;
+		int wakeup_fd;
+		std::atomic<bool> stopping;
+
+		bool flush_batching;
+		unsigned int flush_messages;
+		unsigned int flush_bytes;
+		std::chrono::microseconds flush_delay;
+		unsigned int unflushed;
+		std::chrono::steady_clock::time_point unflushed_since;
+
+		std::map<std::string, registry_interface, std::less<>> registry;
+		std::mutex introspection_mutex;
+		std::atomic<bool> introspection_valid;
+		std::string introspection;
+#ifndef SWIG
+		std::map<std::pair<const object_node *, bool>, std::string> object_introspection;
+#endif
+		std::mutex dispatch_mutex;
+		std::atomic<bool> dispatch_valid;
+		std::vector<dispatch_slot> dispatch_table;
+#ifndef SWIG
+		object_node object_root;
+		unsigned int object_count;
+		std::unordered_map<std::string, std::vector<DbusTinyMatch>, string_hash, std::equal_to<>> signal_filters;
+		DbusTinyStats stats;
+		std::deque<message_waiter> message_waiters;
+		unsigned int queue_limit;
+		DbusTinyOverload overload;
+		bool received_size_set;
+#endif
 };
 
+#ifndef SWIG
+class DbusTinyReply
+{
+	public:
+
+		DbusTinyReply() = delete;
+		DbusTinyReply(const DbusTinyReply &) = delete;
+
+		DbusTinyReply(DBusMessage *message);
+		~DbusTinyReply();
+
+		bool failed() const;
+		bool timed_out() const;
+		const std::string &get_error() const;
+
+		template<typename... R> void receive(R &... rv);
+
+	private:
+
+		[[noreturn]] void receive_failed(const char *signature);
+
+		DBusMessage *message;
+		std::string error;
+};
+
+typedef std::function<void(DbusTinyReply &)> DbusTinyCompletion;
+typedef std::function<void(std::function<void()>)> DbusTinyExecutor;
+
+template<typename... R> class DbusTinyCallAwaiter
+{
+	public:
+
+		DbusTinyCallAwaiter() = delete;
+		DbusTinyCallAwaiter(const DbusTinyCallAwaiter &) = delete;
+
+		DbusTinyCallAwaiter(std::function<void(DbusTinyCompletion)> &&start_in) : start(std::move(start_in))
+		{
+		}
+
+		bool await_ready()
+		{
+			return(false);
+		}
+
+		void await_suspend(std::coroutine_handle<> handle)
+		{
+			start([this, handle](DbusTinyReply &reply)
+			{
+				try
+				{
+					std::apply([&reply](R &... values) { reply.receive(values...); }, rv);
+				}
+				catch(...)
+				{
+					exception = std::current_exception();
+				}
+
+				handle.resume();
+			});
+		}
+
+		std::tuple<R...> await_resume()
+		{
+			if(exception)
+				std::rethrow_exception(exception);
+
+			return(std::move(rv));
+		}
+
+	private:
+
+		static_assert(DbusTinyMarshal::owning<R...>(), "reply values outlive the reply message, use std::string instead of std::string_view or const char *");
+
+		std::function<void(DbusTinyCompletion)> start;
+		std::tuple<R...> rv;
+		std::exception_ptr exception;
+};
+#endif
+
 class DbusTinyClient
 {
 	public:
@@ -102,21 +645,70 @@ class DbusTinyClient
 		DbusTinyClient(const DbusTinyClient &) = delete;
 
 		DbusTinyClient();
+#ifndef SWIG
+		DbusTinyClient(DbusTinyBus bus_type, const std::string &address = "");
+#endif
+		~DbusTinyClient();
 
-		void send_void(const std::string &service, const std::string &interface, const std::string &method);
-		void send_string(const std::string &service, const std::string &interface, const std::string &method, const std::string &parameter);
-		void send_uint32_uint32_string_string(const std::string &service, const std::string &interface, const std::string &method,
+		// milliseconds < 0 selects the 25 s libdbus default, DBUS_TIMEOUT_INFINITE never expires
+		void set_timeout(int milliseconds);
+		int get_timeout();
+		unsigned int send_void(const std::string &service, const std::string &interface, const std::string &method);
+		unsigned int send_string(const std::string &service, const std::string &interface, const std::string &method, const std::string &parameter);
+		unsigned int send_uint32_uint32_string_string(const std::string &service, const std::string &interface, const std::string &method,
 				uint32_t, uint32_t, const std::string &, const std::string &);
-		void send_x3string(const std::string &service, const std::string &interface, const std::string &method,
+		unsigned int send_x3string(const std::string &service, const std::string &interface, const std::string &method,
 				const std::string &, const std::string &, const std::string &);
 		const std::string &receive_string();
+		const std::string &receive_string(unsigned int call);
 		void receive_uint64_uint32_uint32_string_double(uint64_t &, uint32_t &, uint32_t &, std::string &, double &);
+		void receive_uint64_uint32_uint32_string_double(unsigned int call, uint64_t &, uint32_t &, uint32_t &, std::string &, double &);
 		void receive_uint64_uint32_uint32_string_double_swig();
+		void receive_uint64_uint32_uint32_string_double_swig(unsigned int call);
 		void receive_uint64_x3string_x4double(uint64_t &, std::string &, std::string &, std::string &, double &, double &, double &, double &);
+		void receive_uint64_x3string_x4double(unsigned int call, uint64_t &, std::string &, std::string &, std::string &, double &, double &, double &, double &);
 		void receive_uint64_x3string_x4double_swig();
+		void receive_uint64_x3string_x4double_swig(unsigned int call);
 		void receive_uint32_x3uint64(uint32_t &, uint64_t &, uint64_t &, uint64_t &);
+		void receive_uint32_x3uint64(unsigned int call, uint32_t &, uint64_t &, uint64_t &, uint64_t &);
 		void receive_uint32_x3uint64_swig();
+		void receive_uint32_x3uint64_swig(unsigned int call);
+#ifndef SWIG
+		template<typename... A> unsigned int send(const std::string &service, const std::string &interface, const std::string &method, const A &... args);
+		template<typename... A> unsigned int send_timeout(int milliseconds, const std::string &service, const std::string &interface, const std::string &method, const A &... args);
+		template<typename... R> void receive(unsigned int call, R &... rv);
+		// timeout at the deadline keeps the call pending, expiry of the call timeout throws
+		template<typename... R> DbusTinyStatus try_receive(unsigned int call, std::chrono::steady_clock::time_point deadline, R &... rv);
+		template<typename... R, typename... A> std::tuple<R...> call(const std::string &service, const std::string &interface, const std::string &method, const A &... args);
+		template<typename... A> unsigned int send_path(const std::string &service, const std::string &path, const std::string &interface, const std::string &method, const A &... args);
+		template<typename... R, typename... A> std::tuple<R...> call_path(const std::string &service, const std::string &path, const std::string &interface, const std::string &method, const A &... args);
+		template<typename... A> unsigned int send(const DbusTinyPreparedCall &prepared, const A &... args);
+		template<typename... A> unsigned int send_timeout(int milliseconds, const DbusTinyPreparedCall &prepared, const A &... args);
+		template<typename... R, typename... A> std::tuple<R...> call(const DbusTinyPreparedCall &prepared, const A &... args);
+		template<typename... A> DbusTinyResult send_result(unsigned int &call, const std::string &service, const std::string &interface, const std::string &method, const A &... args);
+		template<typename... A> DbusTinyResult send_result(unsigned int &call, const DbusTinyPreparedCall &prepared, const A &... args);
+		template<typename... R> DbusTinyResult receive_result(unsigned int call, R &... rv);
+		template<typename... R, typename... A> DbusTinyResult call_result(std::tuple<R...> &rv, const std::string &service, const std::string &interface, const std::string &method, const A &... args);
+		template<typename... R, typename... A> DbusTinyResult call_result(std::tuple<R...> &rv, const DbusTinyPreparedCall &prepared, const A &... args);
+		template<typename... A> void call_async(const std::string &service, const std::string &interface, const std::string &method, DbusTinyCompletion completion, const A &... args);
+		void set_executor(DbusTinyExecutor executor);
+		template<typename... R, typename... A> DbusTinyCallAwaiter<R...> co_call(const std::string &service, const std::string &interface, const std::string &method, A &&... args);
+#endif
+		bool cancel(unsigned int call);
+		void process(int milliseconds);
+		void flush();
+		int get_poll_fd();
+		int get_poll_timeout();
+		unsigned int get_async_pending();
+#ifndef SWIG
+		const DbusTinyStats &get_stats();
+#endif
 		void signal_string(const std::string &service, const std::string &interface, const std::string &signal, const std::string &parameter);
+#ifndef SWIG
+		void signal_string_batch(const std::string &service, const std::string &interface, const std::vector<std::pair<std::string, std::string>> &signals);
+#endif
+		void signal_batch_begin();
+		void signal_batch_commit();
 
 		const std::string &get_rv_string_0();
 		const std::string &get_rv_string_1();
@@ -133,13 +725,68 @@ class DbusTinyClient
 
 	private:
 
+		struct pending_entry
+		{
+			DBusPendingCall *pending_call;
+			std::chrono::steady_clock::time_point expiry;
+		};
+
+		struct async_context;
+
+		struct async_entry
+		{
+			DBusPendingCall *pending_call;
+			async_context *context;
+		};
+
+		typedef std::multimap<std::chrono::steady_clock::time_point, async_entry> async_map;
+
+		struct async_context
+		{
+			DbusTinyClient *client;
+			DbusTinyCompletion completion;
+			async_map::iterator entry;
+		};
+
+		static void async_notify(DBusPendingCall *pending_call, void *data);
+		static void async_free(void *data);
+
+#ifndef SWIG
+		DbusTinyResult build_call(DBusMessage *&request_message, const std::string &service, const std::string &interface, const std::string &method, const std::string &path = "/");
+		DbusTinyResult queue_send(DBusMessage *request_message, int milliseconds, unsigned int &call);
+		template<typename... A> DbusTinyResult append_send(DBusMessage *request_message, int milliseconds, unsigned int &call, const A &... args);
+		DbusTinyResult wait_reply(unsigned int call, const std::chrono::steady_clock::time_point *deadline, DBusMessage *&reply_message);
+#endif
+		DBusMessage *new_call(const std::string &service, const std::string &interface, const std::string &method, const std::string &path = "/");
+		unsigned int send_call(DBusMessage *request_message, int milliseconds);
+		template<typename... A> unsigned int send_message(DBusMessage *request_message, int milliseconds, const A &... args);
+		void release_connection();
+		[[noreturn]] void append_failed(DBusMessage *request_message);
+		[[noreturn]] void fds_unsupported(DBusMessage *request_message);
+		DBusMessage *receive_reply(unsigned int call, const std::chrono::steady_clock::time_point *deadline = nullptr);
+		[[noreturn]] void receive_failed(DBusMessage *reply_message, const char *signature);
+		unsigned int queue_call(DBusPendingCall *pending_call, int milliseconds);
+		DBusPendingCall *dequeue_call(unsigned int call, std::chrono::steady_clock::time_point &expiry);
+		void send_async(DBusMessage *request_message, int milliseconds, DbusTinyCompletion &&completion);
+		void complete_async(async_context *context, DBusMessage *reply_message);
 		bool path_valid(const std::string &path);
 		bool domain_valid(const std::string &domain);
 
 		DBusError dbus_error;
 		DBusConnection *bus_connection;
-		DBusPendingCall *pending_call;
+		DbusTinyBus bus_type;
+		int timeout;
+		std::map<unsigned int, pending_entry> pending_calls;
+		unsigned int call_serial;
+		unsigned int last_call;
 		unsigned int signal_serial;
+		bool signal_batch;
+		async_map async_calls;
+		DbusTinyExecutor executor;
+		std::exception_ptr async_exception;
+#ifndef SWIG
+		DbusTinyStats stats;
+#endif
 
 		std::string rv_string_0;
 		std::string rv_string_1;
@@ -154,3 +801,469 @@ class DbusTinyClient
 		double rv_double_2;
 		double rv_double_3;
 };
+
+#ifndef SWIG
+class DbusTinySharedClient
+{
+	public:
+
+		DbusTinySharedClient(const DbusTinySharedClient &) = delete;
+
+		DbusTinySharedClient(DbusTinyBus bus_type = DbusTinyBus::system, const std::string &address = "", unsigned int connections = 1);
+		~DbusTinySharedClient();
+
+		void set_timeout(int milliseconds);
+		int get_timeout();
+
+		template<typename... R, typename... A> std::tuple<R...> call(const std::string &service, const std::string &interface, const std::string &method, const A &... args);
+		template<typename... R, typename... A> std::tuple<R...> call_timeout(int milliseconds, const std::string &service, const std::string &interface, const std::string &method, const A &... args);
+		template<typename... R, typename... A> std::tuple<R...> call_path(const std::string &service, const std::string &path, const std::string &interface, const std::string &method, const A &... args);
+		template<typename... R, typename... A> std::tuple<R...> call(const DbusTinyPreparedCall &prepared, const A &... args);
+		template<typename... R, typename... A> std::tuple<R...> call_timeout(int milliseconds, const DbusTinyPreparedCall &prepared, const A &... args);
+		template<typename... R, typename... A> DbusTinyResult call_result(std::tuple<R...> &rv, const std::string &service, const std::string &interface, const std::string &method, const A &... args);
+		template<typename... R, typename... A> DbusTinyResult call_result(std::tuple<R...> &rv, const DbusTinyPreparedCall &prepared, const A &... args);
+		template<typename... A> void signal(const std::string &path, const std::string &interface, const std::string &signal, const A &... args);
+		const DbusTinyStats &get_stats();
+
+	private:
+
+		DBusConnection *open_connection(const std::string &address);
+		DBusConnection *next_connection();
+		void drain(DBusConnection *connection);
+		DbusTinyResult build_call(DBusMessage *&request_message, const std::string &service, const std::string &interface, const std::string &method, const std::string &path = "/");
+		DBusMessage *new_call(const std::string &service, const std::string &interface, const std::string &method, const std::string &path = "/");
+		DBusMessage *new_signal(const std::string &path, const std::string &interface, const std::string &signal);
+		DbusTinyResult exchange(DBusMessage *request_message, int milliseconds, DBusMessage *&reply_message);
+		DBusMessage *send_call(DBusMessage *request_message, int milliseconds);
+		template<typename... R, typename... A> std::tuple<R...> call_message(DBusMessage *request_message, int milliseconds, const A &... args);
+		template<typename... R, typename... A> DbusTinyResult call_message_result(DBusMessage *request_message, int milliseconds, std::tuple<R...> &rv, const A &... args);
+		void send_signal(DBusMessage *signal_message);
+		[[noreturn]] void append_failed(DBusMessage *message);
+		[[noreturn]] void fds_unsupported(DBusMessage *message);
+		[[noreturn]] void receive_failed(DBusMessage *reply_message, const char *signature);
+
+		DbusTinyBus bus_type;
+		std::vector<DBusConnection *> connections;
+		std::atomic<unsigned int> connection_index;
+		std::atomic<int> timeout;
+		DbusTinyStats stats;
+};
+#endif
+
+#ifndef SWIG
+template<> struct DbusTinyType<DbusTinyFd>
+{
+	static constexpr DbusTinySignature<1> signature{ "h" };
+
+	static bool append(DBusMessageIter *iter, const DbusTinyFd &value)
+	{
+		int fd = value.get();
+
+		return(dbus_message_iter_append_basic(iter, DBUS_TYPE_UNIX_FD, &fd));
+	}
+
+	static bool get(DBusMessageIter *iter, DbusTinyFd &value)
+	{
+		int fd;
+
+		if(dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_UNIX_FD)
+			return(false);
+
+		dbus_message_iter_get_basic(iter, &fd);
+
+		if(fd < 0)
+			return(false);
+
+		value.reset(fd);
+
+		return(true);
+	}
+};
+
+template<typename... R> void DbusTinyRequest::receive(R &... rv)
+{
+	static constexpr auto signature = DbusTinyMarshal::signature<R...>();
+	DBusMessageIter iter;
+
+	if(!message)
+		throw(DbusTinyException("receive: no message pending"));
+
+	dbus_message_iter_init(message, &iter);
+
+	if(!DbusTinyMarshal::get_message(&iter, rv...))
+		receive_failed(signature.c_str());
+}
+
+template<typename... A> void DbusTinyRequest::reply(const A &... args)
+{
+	DBusMessage *reply_message;
+	DBusMessageIter iter;
+
+	reply_message = new_reply();
+
+	if(!DbusTinyMarshal::can_send<A...>(connection))
+		fds_unsupported(reply_message);
+
+	dbus_message_iter_init_append(reply_message, &iter);
+
+	if(!DbusTinyMarshal::append_message(&iter, args...))
+		append_failed(reply_message);
+
+	send_reply(reply_message);
+}
+
+template<typename... A> unsigned int DbusTinyClient::send(const std::string &service, const std::string &interface, const std::string &method, const A &... args)
+{
+	return(send_timeout(timeout, service, interface, method, args...));
+}
+
+template<typename... A> unsigned int DbusTinyClient::send_timeout(int milliseconds, const std::string &service, const std::string &interface, const std::string &method, const A &... args)
+{
+	return(send_message(new_call(service, interface, method), milliseconds, args...));
+}
+
+template<typename... A> unsigned int DbusTinyClient::send_path(const std::string &service, const std::string &path, const std::string &interface, const std::string &method, const A &... args)
+{
+	return(send_message(new_call(service, interface, method, path), timeout, args...));
+}
+
+template<typename... A> unsigned int DbusTinyClient::send(const DbusTinyPreparedCall &prepared, const A &... args)
+{
+	return(send_message(prepared.new_message(), timeout, args...));
+}
+
+template<typename... A> unsigned int DbusTinyClient::send_timeout(int milliseconds, const DbusTinyPreparedCall &prepared, const A &... args)
+{
+	return(send_message(prepared.new_message(), milliseconds, args...));
+}
+
+template<typename... A> unsigned int DbusTinyClient::send_message(DBusMessage *request_message, int milliseconds, const A &... args)
+{
+	DBusMessageIter iter;
+
+	if(!DbusTinyMarshal::can_send<A...>(bus_connection))
+		fds_unsupported(request_message);
+
+	dbus_message_iter_init_append(request_message, &iter);
+
+	if(!DbusTinyMarshal::append_message(&iter, args...))
+		append_failed(request_message);
+
+	return(send_call(request_message, milliseconds));
+}
+
+template<typename... A> DbusTinyResult DbusTinyClient::send_result(unsigned int &call, const std::string &service, const std::string &interface, const std::string &method, const A &... args)
+{
+	DBusMessage *request_message;
+	DbusTinyResult result;
+
+	if(!(result = build_call(request_message, service, interface, method)))
+		return(result);
+
+	return(append_send(request_message, timeout, call, args...));
+}
+
+template<typename... A> DbusTinyResult DbusTinyClient::send_result(unsigned int &call, const DbusTinyPreparedCall &prepared, const A &... args)
+{
+	return(append_send(prepared.new_message(), timeout, call, args...));
+}
+
+template<typename... A> DbusTinyResult DbusTinyClient::append_send(DBusMessage *request_message, int milliseconds, unsigned int &call, const A &... args)
+{
+	DBusMessageIter iter;
+
+	if(!DbusTinyMarshal::can_send<A...>(bus_connection))
+	{
+		dbus_message_unref(request_message);
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_NOT_SUPPORTED, "connection cannot pass unix fds"));
+	}
+
+	dbus_message_iter_init_append(request_message, &iter);
+
+	if(!DbusTinyMarshal::append_message(&iter, args...))
+	{
+		dbus_message_unref(request_message);
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_INVALID_ARGS, "error in dbus_message_iter_append"));
+	}
+
+	return(queue_send(request_message, milliseconds, call));
+}
+
+template<typename... R> DbusTinyResult DbusTinyClient::receive_result(unsigned int call, R &... rv)
+{
+	static_assert(DbusTinyMarshal::owning<R...>(), "reply values outlive the reply message, use std::string instead of std::string_view or const char *");
+	DBusMessage *reply_message;
+	DBusMessageIter iter;
+	DbusTinyResult result;
+
+	if(!(result = wait_reply(call, nullptr, reply_message)))
+		return(result);
+
+	dbus_message_iter_init(reply_message, &iter);
+
+	if(!DbusTinyMarshal::get_message(&iter, rv...))
+		result = DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_INVALID_SIGNATURE, "invalid reply signature");
+
+	dbus_message_unref(reply_message);
+
+	return(result);
+}
+
+template<typename... R, typename... A> DbusTinyResult DbusTinyClient::call_result(std::tuple<R...> &rv, const std::string &service, const std::string &interface, const std::string &method, const A &... args)
+{
+	DbusTinyResult result;
+	unsigned int handle;
+
+	if(!(result = send_result(handle, service, interface, method, args...)))
+		return(result);
+
+	return(std::apply([this, handle](R &... values) { return(receive_result(handle, values...)); }, rv));
+}
+
+template<typename... R, typename... A> DbusTinyResult DbusTinyClient::call_result(std::tuple<R...> &rv, const DbusTinyPreparedCall &prepared, const A &... args)
+{
+	DbusTinyResult result;
+	unsigned int handle;
+
+	if(!(result = send_result(handle, prepared, args...)))
+		return(result);
+
+	return(std::apply([this, handle](R &... values) { return(receive_result(handle, values...)); }, rv));
+}
+
+template<typename... R> void DbusTinyClient::receive(unsigned int call, R &... rv)
+{
+	static_assert(DbusTinyMarshal::owning<R...>(), "reply values outlive the reply message, use std::string instead of std::string_view or const char *");
+	static constexpr auto signature = DbusTinyMarshal::signature<R...>();
+	DBusMessage *reply_message;
+	DBusMessageIter iter;
+
+	reply_message = receive_reply(call);
+
+	dbus_message_iter_init(reply_message, &iter);
+
+	if(!DbusTinyMarshal::get_message(&iter, rv...))
+		receive_failed(reply_message, signature.c_str());
+
+	dbus_message_unref(reply_message);
+}
+
+template<typename... R> DbusTinyStatus DbusTinyClient::try_receive(unsigned int call, std::chrono::steady_clock::time_point deadline, R &... rv)
+{
+	static_assert(DbusTinyMarshal::owning<R...>(), "reply values outlive the reply message, use std::string instead of std::string_view or const char *");
+	static constexpr auto signature = DbusTinyMarshal::signature<R...>();
+	DBusMessage *reply_message;
+	DBusMessageIter iter;
+
+	if(!(reply_message = receive_reply(call, &deadline)))
+		return(DbusTinyStatus::timeout);
+
+	dbus_message_iter_init(reply_message, &iter);
+
+	if(!DbusTinyMarshal::get_message(&iter, rv...))
+		receive_failed(reply_message, signature.c_str());
+
+	dbus_message_unref(reply_message);
+
+	return(DbusTinyStatus::ok);
+}
+
+template<typename... A> void DbusTinyClient::call_async(const std::string &service, const std::string &interface, const std::string &method, DbusTinyCompletion completion, const A &... args)
+{
+	DBusMessage *request_message;
+	DBusMessageIter iter;
+
+	request_message = new_call(service, interface, method);
+
+	if(!DbusTinyMarshal::can_send<A...>(bus_connection))
+		fds_unsupported(request_message);
+
+	dbus_message_iter_init_append(request_message, &iter);
+
+	if(!DbusTinyMarshal::append_message(&iter, args...))
+		append_failed(request_message);
+
+	send_async(request_message, timeout, std::move(completion));
+}
+
+template<typename... R, typename... A> DbusTinyCallAwaiter<R...> DbusTinyClient::co_call(const std::string &service, const std::string &interface, const std::string &method, A &&... args)
+{
+	auto arguments = std::make_shared<std::tuple<std::decay_t<A>...>>(std::forward<A>(args)...);
+
+	return(DbusTinyCallAwaiter<R...>([this, service, interface, method, arguments](DbusTinyCompletion completion)
+	{
+		std::apply([&](const std::decay_t<A> &... values) { call_async(service, interface, method, std::move(completion), values...); }, *arguments);
+	}));
+}
+
+template<typename... R, typename... A> std::tuple<R...> DbusTinySharedClient::call(const std::string &service, const std::string &interface, const std::string &method, const A &... args)
+{
+	return(call_timeout<R...>(timeout, service, interface, method, args...));
+}
+
+template<typename... R, typename... A> std::tuple<R...> DbusTinySharedClient::call_timeout(int milliseconds, const std::string &service, const std::string &interface, const std::string &method, const A &... args)
+{
+	return(call_message<R...>(new_call(service, interface, method), milliseconds, args...));
+}
+
+template<typename... R, typename... A> std::tuple<R...> DbusTinySharedClient::call_path(const std::string &service, const std::string &path, const std::string &interface, const std::string &method, const A &... args)
+{
+	return(call_message<R...>(new_call(service, interface, method, path), timeout, args...));
+}
+
+template<typename... R, typename... A> std::tuple<R...> DbusTinySharedClient::call(const DbusTinyPreparedCall &prepared, const A &... args)
+{
+	return(call_message<R...>(prepared.new_message(), timeout, args...));
+}
+
+template<typename... R, typename... A> std::tuple<R...> DbusTinySharedClient::call_timeout(int milliseconds, const DbusTinyPreparedCall &prepared, const A &... args)
+{
+	return(call_message<R...>(prepared.new_message(), milliseconds, args...));
+}
+
+template<typename... R, typename... A> DbusTinyResult DbusTinySharedClient::call_result(std::tuple<R...> &rv, const std::string &service, const std::string &interface, const std::string &method, const A &... args)
+{
+	DBusMessage *request_message;
+	DbusTinyResult result;
+
+	if(!(result = build_call(request_message, service, interface, method)))
+		return(result);
+
+	return(call_message_result(request_message, timeout, rv, args...));
+}
+
+template<typename... R, typename... A> DbusTinyResult DbusTinySharedClient::call_result(std::tuple<R...> &rv, const DbusTinyPreparedCall &prepared, const A &... args)
+{
+	return(call_message_result(prepared.new_message(), timeout, rv, args...));
+}
+
+template<typename... R, typename... A> DbusTinyResult DbusTinySharedClient::call_message_result(DBusMessage *request_message, int milliseconds, std::tuple<R...> &rv, const A &... args)
+{
+	static_assert(DbusTinyMarshal::owning<R...>(), "reply values outlive the reply message, use std::string instead of std::string_view or const char *");
+	DBusMessage *reply_message;
+	DBusMessageIter iter;
+	DbusTinyResult result;
+
+	if(!DbusTinyMarshal::can_send<A...>(connections.front()))
+	{
+		dbus_message_unref(request_message);
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_NOT_SUPPORTED, "connection cannot pass unix fds"));
+	}
+
+	dbus_message_iter_init_append(request_message, &iter);
+
+	if(!DbusTinyMarshal::append_message(&iter, args...))
+	{
+		dbus_message_unref(request_message);
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_INVALID_ARGS, "error in dbus_message_iter_append"));
+	}
+
+	if(!(result = exchange(request_message, milliseconds, reply_message)))
+		return(result);
+
+	dbus_message_iter_init(reply_message, &iter);
+
+	if(!std::apply([&iter](R &... values) { return(DbusTinyMarshal::get_message(&iter, values...)); }, rv))
+		result = DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_INVALID_SIGNATURE, "invalid reply signature");
+
+	dbus_message_unref(reply_message);
+
+	return(result);
+}
+
+template<typename... R, typename... A> std::tuple<R...> DbusTinySharedClient::call_message(DBusMessage *request_message, int milliseconds, const A &... args)
+{
+	static_assert(DbusTinyMarshal::owning<R...>(), "reply values outlive the reply message, use std::string instead of std::string_view or const char *");
+	static constexpr auto signature = DbusTinyMarshal::signature<R...>();
+	DBusMessage *reply_message;
+	DBusMessageIter iter;
+	std::tuple<R...> rv;
+
+	if(!DbusTinyMarshal::can_send<A...>(connections.front()))
+		fds_unsupported(request_message);
+
+	dbus_message_iter_init_append(request_message, &iter);
+
+	if(!DbusTinyMarshal::append_message(&iter, args...))
+		append_failed(request_message);
+
+	reply_message = send_call(request_message, milliseconds);
+
+	dbus_message_iter_init(reply_message, &iter);
+
+	if(!std::apply([&iter](R &... values) { return(DbusTinyMarshal::get_message(&iter, values...)); }, rv))
+		receive_failed(reply_message, signature.c_str());
+
+	dbus_message_unref(reply_message);
+
+	return(rv);
+}
+
+template<typename... A> void DbusTinySharedClient::signal(const std::string &path, const std::string &interface, const std::string &signal_name, const A &... args)
+{
+	DBusMessage *signal_message;
+	DBusMessageIter iter;
+
+	signal_message = new_signal(path, interface, signal_name);
+
+	if(!DbusTinyMarshal::can_send<A...>(connections.front()))
+		fds_unsupported(signal_message);
+
+	dbus_message_iter_init_append(signal_message, &iter);
+
+	if(!DbusTinyMarshal::append_message(&iter, args...))
+		append_failed(signal_message);
+
+	send_signal(signal_message);
+}
+
+template<typename... R> void DbusTinyReply::receive(R &... rv)
+{
+	static constexpr auto signature = DbusTinyMarshal::signature<R...>();
+	DBusMessageIter iter;
+
+	if(failed())
+		throw(DbusTinyException(boost::format("receive: error while receiving reply: %s") % error));
+
+	dbus_message_iter_init(message, &iter);
+
+	if(!DbusTinyMarshal::get_message(&iter, rv...))
+		receive_failed(signature.c_str());
+}
+
+template<typename... R, typename... A> std::tuple<R...> DbusTinyClient::call(const std::string &service, const std::string &interface, const std::string &method, const A &... args)
+{
+	std::tuple<R...> rv;
+	unsigned int handle;
+
+	handle = send(service, interface, method, args...);
+
+	std::apply([this, handle](R &... values) { receive(handle, values...); }, rv);
+
+	return(rv);
+}
+
+template<typename... R, typename... A> std::tuple<R...> DbusTinyClient::call_path(const std::string &service, const std::string &path, const std::string &interface, const std::string &method, const A &... args)
+{
+	std::tuple<R...> rv;
+	unsigned int handle;
+
+	handle = send_path(service, path, interface, method, args...);
+
+	std::apply([this, handle](R &... values) { receive(handle, values...); }, rv);
+
+	return(rv);
+}
+
+template<typename... R, typename... A> std::tuple<R...> DbusTinyClient::call(const DbusTinyPreparedCall &prepared, const A &... args)
+{
+	std::tuple<R...> rv;
+	unsigned int handle;
+
+	handle = send(prepared, args...);
+
+	std::apply([this, handle](R &... values) { receive(handle, values...); }, rv);
+
+	return(rv);
+}
+#endif
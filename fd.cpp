@@ -0,0 +1,99 @@
+#include <dbus-tiny.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <string>
+#include <boost/format.hpp>
+
+DbusTinyFd::DbusTinyFd()
+{
+	fd = -1;
+}
+
+DbusTinyFd::DbusTinyFd(int fd_in)
+{
+	fd = fd_in;
+}
+
+DbusTinyFd::DbusTinyFd(DbusTinyFd &&other) : DbusTinyFd()
+{
+	*this = std::move(other);
+}
+
+DbusTinyFd &DbusTinyFd::operator =(DbusTinyFd &&other)
+{
+	if(this != &other)
+		reset(other.release());
+
+	return(*this);
+}
+
+DbusTinyFd::~DbusTinyFd()
+{
+	reset();
+}
+
+DbusTinyFd DbusTinyFd::sealed(const std::string &name, const void *payload, size_t size)
+{
+	const char *current;
+	ssize_t written;
+	size_t remaining;
+
+	DbusTinyFd rv(memfd_create(name.c_str(), MFD_CLOEXEC | MFD_ALLOW_SEALING));
+
+	if(rv.get() < 0)
+		throw(DbusTinyException(boost::format("sealed: memfd_create failed: %s") % strerror(errno)));
+
+	current = static_cast<const char *>(payload);
+	remaining = size;
+
+	while(remaining > 0)
+	{
+		if((written = write(rv.get(), current, remaining)) < 0)
+		{
+			if(errno == EINTR)
+				continue;
+
+			throw(DbusTinyException(boost::format("sealed: write failed: %s") % strerror(errno)));
+		}
+
+		current += written;
+		remaining -= written;
+	}
+
+	if(fcntl(rv.get(), F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0)
+		throw(DbusTinyException(boost::format("sealed: adding seals failed: %s") % strerror(errno)));
+
+	return(rv);
+}
+
+DbusTinyFd DbusTinyFd::sealed(const std::string &name, const std::string &payload)
+{
+	return(sealed(name, payload.data(), payload.size()));
+}
+
+int DbusTinyFd::get() const
+{
+	return(fd);
+}
+
+int DbusTinyFd::release()
+{
+	int rv = fd;
+
+	fd = -1;
+
+	return(rv);
+}
+
+void DbusTinyFd::reset(int fd_in)
+{
+	if(fd >= 0)
+		close(fd);
+
+	fd = fd_in;
+}
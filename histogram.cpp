@@ -0,0 +1,77 @@
+#include <dbus-tiny-stats.h>
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <map>
+#include <bit>
+
+DbusTinyHistogram::DbusTinyHistogram()
+{
+	for(auto &bucket : counts)
+		bucket = 0;
+
+	count = 0;
+	sum_ns = 0;
+}
+
+void DbusTinyHistogram::record(std::chrono::steady_clock::duration elapsed)
+{
+	uint64_t ns;
+	unsigned int bucket;
+
+	ns = static_cast<uint64_t>(std::max<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), 0));
+	bucket = std::min<unsigned int>(std::bit_width(ns), buckets - 1);
+
+	counts[bucket].fetch_add(1, std::memory_order_relaxed);
+	count.fetch_add(1, std::memory_order_relaxed);
+	sum_ns.fetch_add(ns, std::memory_order_relaxed);
+}
+
+uint64_t DbusTinyHistogram::get_count() const
+{
+	return(count.load(std::memory_order_relaxed));
+}
+
+uint64_t DbusTinyHistogram::get_sum_ns() const
+{
+	return(sum_ns.load(std::memory_order_relaxed));
+}
+
+uint64_t DbusTinyHistogram::get_percentile_ns(double percentile) const
+{
+	uint64_t total, target, seen;
+	unsigned int bucket;
+
+	total = 0;
+
+	for(const auto &entry : counts)
+		total += entry.load(std::memory_order_relaxed);
+
+	if(total == 0)
+		return(0);
+
+	target = static_cast<uint64_t>(static_cast<double>(total) * percentile / 100);
+
+	if(target >= total)
+		target = total - 1;
+
+	seen = 0;
+
+	for(bucket = 0; bucket < buckets; bucket++)
+		if((seen += counts[bucket].load(std::memory_order_relaxed)) > target)
+			break;
+
+	return(bucket ? ((uint64_t(1) << bucket) - 1) : 0);
+}
+
+void DbusTinyHistogram::values(const std::string &name, std::map<std::string, uint64_t> &rv) const
+{
+	rv[name + ".count"] = get_count();
+	rv[name + ".sum_ns"] = get_sum_ns();
+	rv[name + ".p50_ns"] = get_percentile_ns(50);
+	rv[name + ".p99_ns"] = get_percentile_ns(99);
+	rv[name + ".p999_ns"] = get_percentile_ns(99.9);
+}
@@ -0,0 +1,64 @@
+#include <dbus-tiny.h>
+
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <string_view>
+#include <boost/format.hpp>
+
+DbusTinyMapping::DbusTinyMapping(const DbusTinyFd &fd)
+{
+	struct stat fd_stat;
+	int seals;
+
+	address = nullptr;
+	length = 0;
+
+	if(fd.get() < 0)
+		throw(DbusTinyException("mapping: invalid file descriptor"));
+
+	if((seals = fcntl(fd.get(), F_GET_SEALS)) < 0)
+		throw(DbusTinyException(boost::format("mapping: reading seals failed: %s") % strerror(errno)));
+
+	if((seals & (F_SEAL_SHRINK | F_SEAL_WRITE)) != (F_SEAL_SHRINK | F_SEAL_WRITE))
+		throw(DbusTinyException("mapping: file descriptor is not sealed"));
+
+	if(fstat(fd.get(), &fd_stat) < 0)
+		throw(DbusTinyException(boost::format("mapping: fstat failed: %s") % strerror(errno)));
+
+	if(fd_stat.st_size == 0)
+		return;
+
+	if((address = mmap(nullptr, fd_stat.st_size, PROT_READ, MAP_SHARED, fd.get(), 0)) == MAP_FAILED)
+	{
+		address = nullptr;
+		throw(DbusTinyException(boost::format("mapping: mmap failed: %s") % strerror(errno)));
+	}
+
+	length = fd_stat.st_size;
+}
+
+DbusTinyMapping::~DbusTinyMapping()
+{
+	if(address)
+		munmap(address, length);
+}
+
+const void *DbusTinyMapping::data() const
+{
+	return(address);
+}
+
+size_t DbusTinyMapping::size() const
+{
+	return(length);
+}
+
+std::string_view DbusTinyMapping::view() const
+{
+	return(std::string_view(static_cast<const char *>(address), length));
+}
@@ -0,0 +1,48 @@
+#include <dbus-tiny.h>
+
+#include <dbus/dbus.h>
+
+#include <string>
+
+DbusTinyPreparedCall::DbusTinyPreparedCall(const std::string &service, const std::string &interface, const std::string &method, const std::string &path)
+{
+	if(!dbus_validate_bus_name(service.c_str(), nullptr))
+		throw(DbusTinyException("prepared call: invalid service"));
+
+	if((interface != "") && !dbus_validate_interface(interface.c_str(), nullptr))
+		throw(DbusTinyException("prepared call: invalid interface"));
+
+	if(!dbus_validate_member(method.c_str(), nullptr))
+		throw(DbusTinyException("prepared call: invalid method"));
+
+	if(!dbus_validate_path(path.c_str(), nullptr))
+		throw(DbusTinyException("prepared call: invalid path"));
+
+	if(!(message = dbus_message_new_method_call(service.c_str(), path.c_str(), (interface == "") ? nullptr : interface.c_str(), method.c_str())))
+		throw(DbusTinyException("prepared call: error in dbus_message_new_method_call"));
+}
+
+DbusTinyPreparedCall::DbusTinyPreparedCall(DbusTinyPreparedCall &&other) noexcept
+{
+	message = other.message;
+	other.message = nullptr;
+}
+
+DbusTinyPreparedCall::~DbusTinyPreparedCall()
+{
+	if(message)
+		dbus_message_unref(message);
+}
+
+DBusMessage *DbusTinyPreparedCall::new_message() const
+{
+	DBusMessage *request_message;
+
+	if(!message)
+		throw(DbusTinyException("prepared call: moved from"));
+
+	if(!(request_message = dbus_message_copy(message)))
+		throw(DbusTinyException("prepared call: error in dbus_message_copy"));
+
+	return(request_message);
+}
@@ -0,0 +1,51 @@
+#include <dbus-tiny.h>
+
+#include <dbus/dbus.h>
+
+#include <string>
+#include <boost/format.hpp>
+
+DbusTinyReply::DbusTinyReply(DBusMessage *message_in)
+{
+	const char *cstr;
+
+	message = message_in;
+	error = "";
+
+	if(!message)
+		error = "reply timed out";
+	else
+		if(dbus_message_get_type(message) == DBUS_MESSAGE_TYPE_ERROR)
+		{
+			if(dbus_message_get_args(message, nullptr, DBUS_TYPE_STRING, &cstr, DBUS_TYPE_INVALID))
+				error = cstr;
+			else
+				error = dbus_message_get_error_name(message);
+		}
+}
+
+DbusTinyReply::~DbusTinyReply()
+{
+	if(message)
+		dbus_message_unref(message);
+}
+
+bool DbusTinyReply::failed() const
+{
+	return(!message || (dbus_message_get_type(message) == DBUS_MESSAGE_TYPE_ERROR));
+}
+
+bool DbusTinyReply::timed_out() const
+{
+	return(!message || dbus_message_is_error(message, DBUS_ERROR_NO_REPLY));
+}
+
+const std::string &DbusTinyReply::get_error() const
+{
+	return(error);
+}
+
+void DbusTinyReply::receive_failed(const char *signature)
+{
+	throw(DbusTinyException(boost::format("receive: invalid reply, expected signature \"%s\", received \"%s\"") % signature % dbus_message_get_signature(message)));
+}
@@ -0,0 +1,370 @@
+#include <dbus-tiny.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <dbus/dbus.h>
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <boost/format.hpp>
+
+DbusTinyRequest::DbusTinyRequest()
+{
+	dbus_error_init(&dbus_error);
+
+	connection = nullptr;
+	message = nullptr;
+	stats = nullptr;
+	decoded = false;
+	replied = false;
+	message_type = "";
+	message_interface = "";
+	message_method = "";
+	message_path = "";
+	message_string_reply_0 = "";
+	rv_uint32_0 = 0;
+	rv_uint32_1 = 0;
+}
+
+DbusTinyRequest::DbusTinyRequest(DbusTinyRequest &&other) : DbusTinyRequest()
+{
+	*this = std::move(other);
+}
+
+DbusTinyRequest &DbusTinyRequest::operator =(DbusTinyRequest &&other)
+{
+	if(this != &other)
+	{
+		reset();
+
+		connection = other.connection;
+		message = other.message;
+		stats = other.stats;
+		decoded = other.decoded;
+		replied = other.replied;
+		message_type = std::move(other.message_type);
+		message_interface = std::move(other.message_interface);
+		message_method = std::move(other.message_method);
+		message_path = std::move(other.message_path);
+		message_string_reply_0 = std::move(other.message_string_reply_0);
+		rv_uint32_0 = other.rv_uint32_0;
+		rv_uint32_1 = other.rv_uint32_1;
+		rv_string_0 = std::move(other.rv_string_0);
+		rv_string_1 = std::move(other.rv_string_1);
+		rv_string_2 = std::move(other.rv_string_2);
+
+		other.connection = nullptr;
+		other.message = nullptr;
+		other.decoded = false;
+	}
+
+	return(*this);
+}
+
+DbusTinyRequest::~DbusTinyRequest()
+{
+	reset();
+}
+
+void DbusTinyRequest::set(DBusConnection *connection_in, DBusMessage *message_in)
+{
+	set(connection_in, message_in, nullptr);
+}
+
+void DbusTinyRequest::set(DBusConnection *connection_in, DBusMessage *message_in, DbusTinyStats *stats_in)
+{
+	reset();
+
+	connection = connection_in;
+	message = message_in;
+	stats = stats_in;
+	decoded = false;
+	replied = false;
+}
+
+void DbusTinyRequest::reset()
+{
+	if(message)
+	{
+		dbus_message_unref(message);
+		message = nullptr;
+	}
+
+	decoded = false;
+}
+
+bool DbusTinyRequest::pending()
+{
+	return(message != nullptr);
+}
+
+bool DbusTinyRequest::has_replied()
+{
+	return(replied);
+}
+
+bool DbusTinyRequest::has_signature(const std::string &signature)
+{
+	return(message && dbus_message_has_signature(message, signature.c_str()));
+}
+
+void DbusTinyRequest::decode_message()
+{
+	decoded = true;
+
+	if(!message)
+	{
+		message_type = "";
+		message_interface = "";
+		message_method = "";
+		message_path = "";
+		return;
+	}
+
+	switch(dbus_message_get_type(message))
+	{
+		case(DBUS_MESSAGE_TYPE_METHOD_CALL): message_type = "method call"; break;
+		case(DBUS_MESSAGE_TYPE_METHOD_RETURN): message_type = "method return"; break;
+		case(DBUS_MESSAGE_TYPE_ERROR): message_type = "error"; break;
+		case(DBUS_MESSAGE_TYPE_SIGNAL): message_type = "signal"; break;
+		default: message_type = "unknown"; break;
+	}
+
+	message_interface = dbus_message_get_interface(message) ? : "";
+	message_method = dbus_message_get_member(message) ? : "";
+	message_path = dbus_message_get_path(message) ? : "";
+}
+
+const std::string &DbusTinyRequest::receive_string()
+{
+	receive(message_string_reply_0);
+
+	return(message_string_reply_0);
+}
+
+void DbusTinyRequest::receive_x3string(std::string &p0, std::string &p1, std::string &p2)
+{
+	receive(p0, p1, p2);
+}
+
+void DbusTinyRequest::receive_x3string_swig()
+{
+	receive_x3string(rv_string_0, rv_string_1, rv_string_2);
+}
+
+void DbusTinyRequest::receive_uint32_uint32_string_string(uint32_t &p1, uint32_t &p2, std::string &p3, std::string &p4)
+{
+	receive(p1, p2, p3, p4);
+}
+
+void DbusTinyRequest::receive_uint32_uint32_string_string_swig()
+{
+	receive_uint32_uint32_string_string(rv_uint32_0, rv_uint32_1, rv_string_0, rv_string_1);
+}
+
+void DbusTinyRequest::send_string(DbusTinyCString reply_string)
+{
+	reply(reply_string);
+}
+
+void DbusTinyRequest::send_uint64_uint32_uint32_string_double(uint64_t p1, uint32_t p2, uint32_t p3, DbusTinyCString p4, double p5)
+{
+	reply(p1, p2, p3, p4, p5);
+}
+
+void DbusTinyRequest::send_uint64_x3string_x4double(uint64_t p0, DbusTinyCString p1, DbusTinyCString p2, DbusTinyCString p3, double p4, double p5, double p6, double p7)
+{
+	reply(p0, p1, p2, p3, p4, p5, p6, p7);
+}
+
+void DbusTinyRequest::send_uint32_x3uint64(uint32_t p0, uint64_t p1, uint64_t p2, uint64_t p3)
+{
+	reply(p0, p1, p2, p3);
+}
+
+const std::string &DbusTinyRequest::inform_error(const std::string &reason)
+{
+	DbusTinyResult result;
+
+	if(!(result = reply_error(DBUS_ERROR_FAILED, reason.c_str())))
+		result.raise("method error - ");
+
+	return(reason);
+}
+
+DbusTinyResult DbusTinyRequest::reply_error(const char *name, const char *text)
+{
+	DBusMessage *error_message;
+
+	if(!message)
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_FAILED, "no message pending"));
+
+	if(!(error_message = dbus_message_new_error(message, name, text)))
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_NO_MEMORY, "error in dbus_message_new_error"));
+
+	if(!dbus_connection_send(connection, error_message, nullptr))
+	{
+		dbus_message_unref(error_message);
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_NO_MEMORY, "error in dbus_connection_send"));
+	}
+
+	dbus_message_unref(error_message);
+
+	replied = true;
+
+	if(stats)
+		DbusTinyStats::add(stats->errors_sent);
+
+	return(DbusTinyResult());
+}
+
+DBusMessage *DbusTinyRequest::new_reply()
+{
+	DBusMessage *reply_message;
+
+	if(!message)
+		throw(DbusTinyException("reply: no message pending"));
+
+	if(!(reply_message = dbus_message_new_method_return(message)))
+		throw(DbusTinyException("dbus_message_new_method_return failed"));
+
+	return(reply_message);
+}
+
+void DbusTinyRequest::send_reply(DBusMessage *reply_message)
+{
+	if(!dbus_connection_send(connection, reply_message, NULL))
+	{
+		dbus_message_unref(reply_message);
+		throw(DbusTinyException("dbus_connection_send failed"));
+	}
+
+	replied = true;
+
+	if(stats)
+		DbusTinyStats::add(stats->replies_sent);
+
+	dbus_message_unref(reply_message);
+}
+
+void DbusTinyRequest::append_failed(DBusMessage *reply_message)
+{
+	dbus_message_unref(reply_message);
+
+	throw(DbusTinyException("dbus_message_iter_append failed"));
+}
+
+void DbusTinyRequest::fds_unsupported(DBusMessage *reply_message)
+{
+	dbus_message_unref(reply_message);
+
+	throw(DbusTinyException("reply: connection cannot pass unix fds"));
+}
+
+void DbusTinyRequest::receive_failed(const char *signature)
+{
+	throw(DbusTinyException(boost::format("receive: invalid arguments, expected signature \"%s\", received \"%s\"") % signature % dbus_message_get_signature(message)));
+}
+
+const std::string &DbusTinyRequest::get_message_type()
+{
+	if(!decoded)
+		decode_message();
+
+	return(message_type);
+}
+
+const std::string &DbusTinyRequest::get_message_interface()
+{
+	if(!decoded)
+		decode_message();
+
+	return(message_interface);
+}
+
+const std::string &DbusTinyRequest::get_message_method()
+{
+	if(!decoded)
+		decode_message();
+
+	return(message_method);
+}
+
+const std::string &DbusTinyRequest::get_message_path()
+{
+	if(!decoded)
+		decode_message();
+
+	return(message_path);
+}
+
+DbusTinyMessageType DbusTinyRequest::get_type()
+{
+	if(!message)
+		return(DbusTinyMessageType::unknown);
+
+	switch(dbus_message_get_type(message))
+	{
+		case(DBUS_MESSAGE_TYPE_METHOD_CALL): return(DbusTinyMessageType::method_call);
+		case(DBUS_MESSAGE_TYPE_METHOD_RETURN): return(DbusTinyMessageType::method_return);
+		case(DBUS_MESSAGE_TYPE_ERROR): return(DbusTinyMessageType::error);
+		case(DBUS_MESSAGE_TYPE_SIGNAL): return(DbusTinyMessageType::signal);
+		default: return(DbusTinyMessageType::unknown);
+	}
+}
+
+std::string_view DbusTinyRequest::get_interface()
+{
+	const char *interface;
+
+	if(!message || !(interface = dbus_message_get_interface(message)))
+		return(std::string_view());
+
+	return(std::string_view(interface));
+}
+
+std::string_view DbusTinyRequest::get_method()
+{
+	const char *method;
+
+	if(!message || !(method = dbus_message_get_member(message)))
+		return(std::string_view());
+
+	return(std::string_view(method));
+}
+
+std::string_view DbusTinyRequest::get_path()
+{
+	const char *path;
+
+	if(!message || !(path = dbus_message_get_path(message)))
+		return(std::string_view());
+
+	return(std::string_view(path));
+}
+
+uint32_t DbusTinyRequest::get_rv_uint32_0()
+{
+	return(rv_uint32_0);
+}
+
+uint32_t DbusTinyRequest::get_rv_uint32_1()
+{
+	return(rv_uint32_1);
+}
+
+const std::string &DbusTinyRequest::get_rv_string_0()
+{
+	return(rv_string_0);
+}
+
+const std::string &DbusTinyRequest::get_rv_string_1()
+{
+	return(rv_string_1);
+}
+
+const std::string &DbusTinyRequest::get_rv_string_2()
+{
+	return(rv_string_2);
+}
@@ -0,0 +1,102 @@
+#include <dbus-tiny.h>
+
+#include <dbus/dbus.h>
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+DbusTinyResult::DbusTinyResult()
+{
+	status = DbusTinyStatus::ok;
+	message = nullptr;
+	name = "";
+	text = "";
+}
+
+DbusTinyResult::DbusTinyResult(DbusTinyStatus status_in, const char *name_in, const char *text_in)
+{
+	status = status_in;
+	message = nullptr;
+	name = name_in;
+	text = text_in;
+}
+
+DbusTinyResult::DbusTinyResult(DBusMessage *error_message)
+{
+	DBusMessageIter iter;
+
+	message = error_message;
+	name = dbus_message_get_error_name(message) ? : DBUS_ERROR_FAILED;
+	text = name;
+
+	if(dbus_message_iter_init(message, &iter) && (dbus_message_iter_get_arg_type(&iter) == DBUS_TYPE_STRING))
+		dbus_message_iter_get_basic(&iter, &text);
+
+	status = dbus_message_is_error(message, DBUS_ERROR_NO_REPLY) ? DbusTinyStatus::timeout : DbusTinyStatus::error;
+}
+
+DbusTinyResult::DbusTinyResult(DbusTinyResult &&other) noexcept : DbusTinyResult()
+{
+	*this = std::move(other);
+}
+
+DbusTinyResult &DbusTinyResult::operator =(DbusTinyResult &&other) noexcept
+{
+	if(this != &other)
+	{
+		if(message)
+			dbus_message_unref(message);
+
+		status = other.status;
+		message = other.message;
+		name = other.name;
+		text = other.text;
+
+		other.status = DbusTinyStatus::ok;
+		other.message = nullptr;
+		other.name = "";
+		other.text = "";
+	}
+
+	return(*this);
+}
+
+DbusTinyResult::~DbusTinyResult()
+{
+	if(message)
+		dbus_message_unref(message);
+}
+
+DbusTinyResult::operator bool() const
+{
+	return(status == DbusTinyStatus::ok);
+}
+
+bool DbusTinyResult::ok() const
+{
+	return(status == DbusTinyStatus::ok);
+}
+
+DbusTinyStatus DbusTinyResult::get_status() const
+{
+	return(status);
+}
+
+std::string_view DbusTinyResult::get_error_name() const
+{
+	return(name);
+}
+
+std::string_view DbusTinyResult::get_error_message() const
+{
+	return(text);
+}
+
+void DbusTinyResult::raise(const char *prefix) const
+{
+	if(message)
+		throw(DbusTinyException(std::string(prefix) + "error while receiving reply: " + text));
+
+	throw(DbusTinyException(std::string(prefix) + text));
+}
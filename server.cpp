@@ -2,368 +2,1709 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/eventfd.h>
 #include <dbus/dbus.h>
 
 #include <string>
-#include <iostream>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <map>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
 #include <boost/format.hpp>
 
-DbusTinyServer::DbusTinyServer(const std::string &bus)
+static const long default_max_received_size = 4 * 1024 * 1024;
+
+DbusTinyServer::DbusTinyServer(const std::string &bus) : DbusTinyServer(bus, DbusTinyBus::system)
+{
+}
+
+DbusTinyServer::DbusTinyServer(const std::string &bus, DbusTinyBus bus_type_in, const std::string &address)
 {
 	int rv;
 	std::string error_message;
 
+	bus_connection = nullptr;
+	bus_type = bus_type_in;
+	wakeup_fd = -1;
+	stopping = false;
+	flush_batching = false;
+	flush_messages = 0;
+	flush_bytes = 0;
+	flush_delay = std::chrono::microseconds(0);
+	unflushed = 0;
+	queue_limit = 0;
+	overload = DbusTinyOverload::block;
+	received_size_set = false;
+	introspection_valid = false;
+	dispatch_valid = false;
+	object_count = 0;
+
+	if(!dbus_threads_init_default())
+		throw(DbusTinyException("dbus_threads_init_default failed"));
+
 	dbus_error_init(&dbus_error);
 
-	bus_connection = dbus_bus_get(DBUS_BUS_SYSTEM, &dbus_error);
+	try
+	{
+		if(bus_type == DbusTinyBus::peer)
+			accept_peer(address);
+		else
+		{
+			if(bus_type == DbusTinyBus::address)
+			{
+				if((bus_connection = dbus_connection_open_private(address.c_str(), &dbus_error)))
+					dbus_bus_register(bus_connection, &dbus_error);
+			}
+			else
+				bus_connection = dbus_bus_get((bus_type == DbusTinyBus::session) ? DBUS_BUS_SESSION : DBUS_BUS_SYSTEM, &dbus_error);
+
+			if(dbus_error_is_set(&dbus_error))
+			{
+				error_message = dbus_error.message;
+				dbus_error_free(&dbus_error);
+				throw(DbusTinyException(std::string("dbus bus get failed: ") + error_message));
+			}
+
+			if(!bus_connection)
+				throw(DbusTinyException("dbus bus get failed (bus_connection = nullptr)"));
+
+			rv = dbus_bus_request_name(bus_connection, bus.c_str(), DBUS_NAME_FLAG_DO_NOT_QUEUE, &dbus_error);
+
+			if(dbus_error_is_set(&dbus_error))
+			{
+				error_message = dbus_error.message;
+				dbus_error_free(&dbus_error);
+				throw(DbusTinyException(std::string("dbus request name failed: ") + error_message));
+			}
+
+			if(rv != DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER)
+				throw(DbusTinyException("dbus request name: not primary owner: "));
+		}
+
+		if(!dbus_connection_set_watch_functions(bus_connection, add_watch, remove_watch, toggle_watch, this, nullptr))
+			throw(DbusTinyException("dbus_connection_set_watch_functions failed"));
 
-	if(dbus_error_is_set(&dbus_error))
+		if(!dbus_connection_set_timeout_functions(bus_connection, add_timeout, remove_timeout, toggle_timeout, this, nullptr))
+			throw(DbusTinyException("dbus_connection_set_timeout_functions failed"));
+
+		if((wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+			throw(DbusTinyException("eventfd failed"));
+	}
+	catch(...)
 	{
-		error_message = dbus_error.message;
-		dbus_error_free(&dbus_error);
-		throw(DbusTinyException(std::string("dbus bus get failed: ") + error_message));
+		release_connection();
+		throw;
+	}
+
+	dbus_connection_set_wakeup_main_function(bus_connection, wakeup_main, this, nullptr);
+}
+
+DbusTinyServer::~DbusTinyServer()
+{
+	if(flush_batching && bus_connection)
+		flush();
+
+	dbus_connection_set_wakeup_main_function(bus_connection, nullptr, nullptr, nullptr);
+	dbus_connection_set_watch_functions(bus_connection, nullptr, nullptr, nullptr, nullptr, nullptr);
+	dbus_connection_set_timeout_functions(bus_connection, nullptr, nullptr, nullptr, nullptr, nullptr);
+
+	if(wakeup_fd >= 0)
+		close(wakeup_fd);
+
+	for(auto &waiter : message_waiters)
+		waiter.handle.destroy();
+
+	if((bus_type == DbusTinyBus::address) || (bus_type == DbusTinyBus::peer))
+	{
+		dbus_connection_close(bus_connection);
+		dbus_connection_unref(bus_connection);
 	}
+}
 
+void DbusTinyServer::release_connection()
+{
 	if(!bus_connection)
-		throw(DbusTinyException("dbus bus get failed (bus_connection = nullptr)"));
+		return;
+
+	dbus_connection_set_watch_functions(bus_connection, nullptr, nullptr, nullptr, nullptr, nullptr);
+	dbus_connection_set_timeout_functions(bus_connection, nullptr, nullptr, nullptr, nullptr, nullptr);
+
+	if((bus_type == DbusTinyBus::address) || (bus_type == DbusTinyBus::peer))
+		dbus_connection_close(bus_connection);
+
+	dbus_connection_unref(bus_connection);
+	bus_connection = nullptr;
+}
+
+void DbusTinyServer::accept_peer(const std::string &address)
+{
+	std::vector<struct pollfd> fds;
+	std::string error_message;
+	DBusServer *listener;
 
-	rv = dbus_bus_request_name(bus_connection, bus.c_str(), DBUS_NAME_FLAG_DO_NOT_QUEUE, &dbus_error);
+	listener = dbus_server_listen(address.c_str(), &dbus_error);
 
 	if(dbus_error_is_set(&dbus_error))
 	{
 		error_message = dbus_error.message;
 		dbus_error_free(&dbus_error);
-		throw(DbusTinyException(std::string("dbus request name failed: ") + error_message));
+		throw(DbusTinyException(std::string("dbus server listen failed: ") + error_message));
+	}
+
+	if(!listener)
+		throw(DbusTinyException("dbus server listen failed (listener = nullptr)"));
+
+	dbus_server_set_new_connection_function(listener, new_connection, this, nullptr);
+
+	if(dbus_server_set_watch_functions(listener, add_watch, remove_watch, toggle_watch, this, nullptr))
+	{
+		while(!bus_connection)
+		{
+			get_poll_fds(fds);
+
+			if(poll(fds.data(), fds.size(), -1) < 0)
+			{
+				if(errno == EINTR)
+					continue;
+
+				break;
+			}
+
+			dispatch_ready(fds);
+		}
 	}
 
-	if(rv != DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER)
-		throw(DbusTinyException("dbus request name: not primary owner: "));
+	dbus_server_set_watch_functions(listener, nullptr, nullptr, nullptr, nullptr, nullptr);
+	dbus_server_disconnect(listener);
+	dbus_server_unref(listener);
 
-	pending_message = nullptr;
-	message_type = "";
-	message_interface = "";
-	message_method = "";
-	message_string_reply_0 = "";
+	if(!bus_connection)
+		throw(DbusTinyException("dbus server accept failed"));
 }
 
-DbusTinyServer::~DbusTinyServer()
+void DbusTinyServer::register_signal(const std::string &interface)
 {
+	DbusTinyMatch match;
+
+	match.interface = interface;
+
+	register_signal(match);
 }
 
-void DbusTinyServer::register_signal(const std::string &interface)
+void DbusTinyServer::register_signal(const DbusTinyMatch &match)
 {
 	std::string filter;
 	std::string error_message;
 
-	filter = (boost::format("type='%s',interface='%s'") % "signal" % interface).str();
+	filter = match_rule(match);
 
-	dbus_bus_add_match(bus_connection, filter.c_str(), &dbus_error);
+	if(bus_type != DbusTinyBus::peer)
+	{
+		dbus_bus_add_match(bus_connection, filter.c_str(), &dbus_error);
 
-	dbus_connection_flush(bus_connection);
+		dbus_connection_flush(bus_connection);
 
-	if(dbus_error_is_set(&dbus_error))
-	{
-		error_message = dbus_error.message;
-		dbus_error_free(&dbus_error);
-		throw(DbusTinyException(std::string("dbus_bus_add_match failed: ") + error_message));
+		if(dbus_error_is_set(&dbus_error))
+		{
+			error_message = dbus_error.message;
+			dbus_error_free(&dbus_error);
+			throw(DbusTinyException(std::string("dbus_bus_add_match failed: ") + error_message));
+		}
 	}
+
+	signal_filters[match.interface].push_back(match);
 }
 
-void DbusTinyServer::get_message(std::string &type, std::string &interface, std::string &method)
+void DbusTinyServer::unregister_signal(const DbusTinyMatch &match)
 {
-	if((pending_message = dbus_connection_pop_message(bus_connection)))
-		goto done;
+	std::string filter;
+	std::string error_message;
 
-	dbus_connection_flush(bus_connection);
+	auto bucket = signal_filters.find(match.interface);
+	std::vector<DbusTinyMatch>::iterator entry;
 
-	if(!dbus_connection_read_write(bus_connection, -1))
-		throw(DbusTinyException("dbus_connection_read_write failed"));
+	if((bucket == signal_filters.end()) || ((entry = std::find(bucket->second.begin(), bucket->second.end(), match)) == bucket->second.end()))
+		throw(DbusTinyException("unregister_signal: match not registered"));
 
-	if((pending_message = dbus_connection_pop_message(bus_connection)))
-		goto done;
+	filter = match_rule(match);
 
-	while(dbus_connection_dispatch(bus_connection) != DBUS_DISPATCH_COMPLETE)
+	if(bus_type != DbusTinyBus::peer)
 	{
-		std::cerr << "* call dispatch\n";
+		dbus_bus_remove_match(bus_connection, filter.c_str(), &dbus_error);
 
-		if((pending_message = dbus_connection_pop_message(bus_connection)))
+		if(dbus_error_is_set(&dbus_error))
 		{
-			std::cerr << "* pop succeeded @3\n";
-			goto done;
+			error_message = dbus_error.message;
+			dbus_error_free(&dbus_error);
+			throw(DbusTinyException(std::string("dbus_bus_remove_match failed: ") + error_message));
 		}
-
-		std::cerr << "* repeating dispatch\n";
 	}
 
-	if(!(pending_message = dbus_connection_pop_message(bus_connection)))
+	bucket->second.erase(entry);
+
+	if(bucket->second.empty())
+		signal_filters.erase(bucket);
+}
+
+static std::string match_quote(const std::string &value)
+{
+	std::string rv;
+
+	rv = "'";
+
+	for(char c : value)
 	{
-		std::cerr << "* pop succeeded @4\n";
-		goto done;
+		if(c == '\'')
+			rv += "'\\''";
+		else
+			rv += c;
 	}
 
-	throw(DbusTinyException("dispatch/pop failed"));
+	rv += "'";
 
-done:
-	switch(dbus_message_get_type(pending_message))
+	return(rv);
+}
+
+std::string DbusTinyServer::match_rule(const DbusTinyMatch &match)
+{
+	std::string rule;
+
+	if(!match.sender.empty() && !dbus_validate_bus_name(match.sender.c_str(), nullptr))
+		throw(DbusTinyException(boost::format("register_signal: invalid sender: %s") % match.sender));
+
+	if(!match.path.empty() && !dbus_validate_path(match.path.c_str(), nullptr))
+		throw(DbusTinyException(boost::format("register_signal: invalid path: %s") % match.path));
+
+	if(!match.path_namespace.empty() && !dbus_validate_path(match.path_namespace.c_str(), nullptr))
+		throw(DbusTinyException(boost::format("register_signal: invalid path namespace: %s") % match.path_namespace));
+
+	if(!match.path.empty() && !match.path_namespace.empty())
+		throw(DbusTinyException("register_signal: path and path namespace are mutually exclusive"));
+
+	if(!match.interface.empty() && !dbus_validate_interface(match.interface.c_str(), nullptr))
+		throw(DbusTinyException(boost::format("register_signal: invalid interface: %s") % match.interface));
+
+	if(!match.member.empty() && !dbus_validate_member(match.member.c_str(), nullptr))
+		throw(DbusTinyException(boost::format("register_signal: invalid member: %s") % match.member));
+
+	if(!match.args.empty() && (match.args.rbegin()->first > 63))
+		throw(DbusTinyException("register_signal: argument index out of range"));
+
+	if(!match.arg0_namespace.empty() && match.args.count(0))
+		throw(DbusTinyException("register_signal: arg0 and arg0 namespace are mutually exclusive"));
+
+	rule = "type='signal'";
+
+	if(!match.sender.empty())
+		rule += ",sender=" + match_quote(match.sender);
+
+	if(!match.path.empty())
+		rule += ",path=" + match_quote(match.path);
+
+	if(!match.path_namespace.empty())
+		rule += ",path_namespace=" + match_quote(match.path_namespace);
+
+	if(!match.interface.empty())
+		rule += ",interface=" + match_quote(match.interface);
+
+	if(!match.member.empty())
+		rule += ",member=" + match_quote(match.member);
+
+	for(const auto &arg : match.args)
+		rule += (boost::format(",arg%u=") % arg.first).str() + match_quote(arg.second);
+
+	if(!match.arg0_namespace.empty())
+		rule += ",arg0namespace=" + match_quote(match.arg0_namespace);
+
+	return(rule);
+}
+
+DBusMessage *DbusTinyServer::pop_message()
+{
+	DBusMessage *message;
+
+	while((message = dbus_connection_pop_message(bus_connection)))
 	{
-		case(DBUS_MESSAGE_TYPE_METHOD_CALL): type = "method call"; break;
-		case(DBUS_MESSAGE_TYPE_METHOD_RETURN): type = "method return"; break;
-		case(DBUS_MESSAGE_TYPE_ERROR): type = "error"; break;
-		case(DBUS_MESSAGE_TYPE_SIGNAL): type = "signal"; break;
-		default: type = "unknown"; break;
+		stats.received(message);
+
+		if(signal_wanted(message))
+			return(message);
+
+		DbusTinyStats::add(stats.signals_dropped);
+		dbus_message_unref(message);
 	}
 
-	interface = dbus_message_get_interface(pending_message) ? : "";
-	method = dbus_message_get_member(pending_message);
+	return(nullptr);
 }
 
-void DbusTinyServer::get_message_swig()
+bool DbusTinyServer::signal_wanted(DBusMessage *message)
 {
-	get_message(message_type, message_interface, message_method);
+	const char *interface;
+
+	if(signal_filters.empty() || (dbus_message_get_type(message) != DBUS_MESSAGE_TYPE_SIGNAL) || dbus_message_get_destination(message))
+		return(true);
+
+	interface = dbus_message_get_interface(message) ? : "";
+
+	for(std::string_view key : { std::string_view(interface), std::string_view() })
+	{
+		auto bucket = signal_filters.find(key);
+
+		if(bucket != signal_filters.end())
+			for(const auto &match : bucket->second)
+				if(signal_matches(message, match))
+					return(true);
+
+		if(!*interface)
+			break;
+	}
+
+	return(false);
 }
 
-const std::string &DbusTinyServer::receive_string()
+bool DbusTinyServer::signal_matches(DBusMessage *message, const DbusTinyMatch &match)
 {
-	const char *s1;
-	std::string error_message;
+	DBusMessageIter iter;
+	const char *value;
+	unsigned int index;
+	size_t length;
 
-	dbus_message_get_args(pending_message, &dbus_error, DBUS_TYPE_STRING, &s1, DBUS_TYPE_INVALID);
+	if(!match.member.empty() && !dbus_message_has_member(message, match.member.c_str()))
+		return(false);
 
-	if(dbus_error_is_set(&dbus_error))
+	if(!match.path.empty() && !dbus_message_has_path(message, match.path.c_str()))
+		return(false);
+
+	if(!match.path_namespace.empty() && (match.path_namespace != "/"))
 	{
-		error_message = dbus_error.message;
-		dbus_error_free(&dbus_error);
-		throw(DbusTinyException(std::string("dbus_message_get_args failed: ") + error_message));
+		if(!(value = dbus_message_get_path(message)))
+			return(false);
+
+		length = match.path_namespace.length();
+
+		if(strncmp(value, match.path_namespace.c_str(), length) || (value[length] && (value[length] != '/')))
+			return(false);
 	}
 
-	message_string_reply_0 = s1;
+	if((match.sender.length() > 0) && (match.sender.at(0) == ':') && !dbus_message_has_sender(message, match.sender.c_str()))
+		return(false);
 
-	return(message_string_reply_0);
-}
+	if(match.args.empty() && match.arg0_namespace.empty())
+		return(true);
 
-void DbusTinyServer::receive_x3string(std::string &p0, std::string &p1, std::string &p2)
-{
-	const char *s0, *s1, *s2;
-	std::string error_message;
+	if(!dbus_message_iter_init(message, &iter))
+		return(false);
 
-	dbus_message_get_args(pending_message, &dbus_error,
-			DBUS_TYPE_STRING, &s0,
-			DBUS_TYPE_STRING, &s1,
-			DBUS_TYPE_STRING, &s2,
-			DBUS_TYPE_INVALID);
+	auto arg = match.args.begin();
 
-	if(dbus_error_is_set(&dbus_error))
+	for(index = 0; (arg != match.args.end()) || ((index == 0) && !match.arg0_namespace.empty()); index++)
 	{
-		error_message = dbus_error.message;
-		dbus_error_free(&dbus_error);
-		throw(DbusTinyException(std::string("dbus_message_get_args failed: ") + error_message));
+		if((index > 0) && !dbus_message_iter_next(&iter))
+			return(false);
+
+		if((index == 0) && !match.arg0_namespace.empty())
+		{
+			if(dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_STRING)
+				return(false);
+
+			dbus_message_iter_get_basic(&iter, &value);
+			length = match.arg0_namespace.length();
+
+			if(strncmp(value, match.arg0_namespace.c_str(), length) || (value[length] && (value[length] != '.')))
+				return(false);
+		}
+
+		if((arg != match.args.end()) && (arg->first == index))
+		{
+			if(dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_STRING)
+				return(false);
+
+			dbus_message_iter_get_basic(&iter, &value);
+
+			if(arg->second != value)
+				return(false);
+
+			arg++;
+		}
 	}
 
-	p0 = s0;
-	p1 = s1;
-	p2 = s2;
+	return(true);
 }
 
-void DbusTinyServer::receive_x3string_swig()
+DBusMessage *DbusTinyServer::read_message()
 {
-	receive_x3string(rv_string_0, rv_string_1, rv_string_2);
+	DBusMessage *message;
+
+	check_unlimited("get_message");
+
+	if((message = pop_message()))
+		goto done;
+
+read:
+	if(!flush_batching)
+		flush();
+	else
+		unflushed = 0;
+
+	{
+		DbusTinyStatsTimer timer(stats.wait);
+
+		if(!dbus_connection_read_write(bus_connection, -1))
+		{
+			if((message = pop_message()))
+				goto done;
+
+			throw(DbusTinyException("dbus_connection_read_write failed"));
+		}
+	}
+
+	if((message = pop_message()))
+		goto done;
+
+	while(dbus_connection_dispatch(bus_connection) != DBUS_DISPATCH_COMPLETE)
+		if((message = pop_message()))
+			goto done;
+
+	if((message = pop_message()))
+		goto done;
+
+	goto read;
+
+done:
+	return(message);
 }
 
-void DbusTinyServer::receive_uint32_uint32_string_string(uint32_t &p1, uint32_t &p2, std::string &p3, std::string &p4)
+unsigned int DbusTinyServer::get_messages(unsigned int max, std::vector<DbusTinyRequest> &requests)
 {
-	dbus_uint32_t s1, s2;
-	const char *s3, *s4;
-	std::string error_message;
+	DBusMessage *message;
 
-	dbus_message_get_args(pending_message, &dbus_error, DBUS_TYPE_UINT32, &s1, DBUS_TYPE_UINT32, &s2, DBUS_TYPE_STRING, &s3, DBUS_TYPE_STRING, &s4, DBUS_TYPE_INVALID);
+	check_unlimited("get_messages");
 
-	if(dbus_error_is_set(&dbus_error))
+	if(max == 0)
+		throw(DbusTinyException("get_messages: max must be at least 1"));
+
+	requests.clear();
+
+	message = read_message();
+
+	for(;;)
 	{
-		error_message = dbus_error.message;
-		dbus_error_free(&dbus_error);
-		throw(DbusTinyException(std::string("dbus_message_get_args failed: ") + error_message));
+		requests.emplace_back();
+		requests.back().set(bus_connection, message, &stats);
+
+		if(requests.size() >= max)
+			break;
+
+		while(!(message = pop_message()))
+			if(!dbus_connection_read_write(bus_connection, 0) || (dbus_connection_get_dispatch_status(bus_connection) != DBUS_DISPATCH_DATA_REMAINS))
+				return(requests.size());
 	}
 
-	p1 = s1;
-	p2 = s2;
-	p3 = s3;
-	p4 = s4;
+	return(requests.size());
 }
 
-void DbusTinyServer::receive_uint32_uint32_string_string_swig()
+void DbusTinyServer::get_message(std::string &type, std::string &interface, std::string &method)
+{
+	request.set(bus_connection, read_message(), &stats);
+
+	type = request.get_message_type();
+	interface = request.get_message_interface();
+	method = request.get_message_method();
+}
+
+void DbusTinyServer::get_message_swig()
 {
-	receive_uint32_uint32_string_string(rv_uint32_0, rv_uint32_1, rv_string_0, rv_string_1);
+	request.set(bus_connection, read_message(), &stats);
 }
 
-void DbusTinyServer::send_string(const std::string &reply_string)
+void DbusTinyServer::get_message(DbusTinyMessageType &type, std::string_view &interface, std::string_view &method)
 {
-	DBusMessage *reply_message;
-	const char *reply_cstr;
+	request.set(bus_connection, read_message(), &stats);
 
-	reply_cstr = reply_string.c_str();
+	type = request.get_type();
+	interface = request.get_interface();
+	method = request.get_method();
+}
 
-	if(!(reply_message = dbus_message_new_method_return(pending_message)))
-		throw(DbusTinyException("dbus_message_new_method_return failed"));
+bool DbusTinyServer::try_get_message(DbusTinyMessageType &type, std::string_view &interface, std::string_view &method)
+{
+	if(!try_get_message_swig())
+		return(false);
 
-	if(!dbus_message_append_args(reply_message, DBUS_TYPE_STRING, &reply_cstr, DBUS_TYPE_INVALID))
-	{
-		dbus_message_unref(reply_message);
-		throw(DbusTinyException("dbus_message_append_args failed"));
-	}
+	type = request.get_type();
+	interface = request.get_interface();
+	method = request.get_method();
 
-	if(!dbus_connection_send(bus_connection, reply_message, NULL))
-	{
-		dbus_message_unref(reply_message);
-		throw(DbusTinyException("dbus_connection_send failed"));
-	}
+	return(true);
+}
 
-	dbus_message_unref(reply_message);
+bool DbusTinyServer::try_get_message(std::string &type, std::string &interface, std::string &method)
+{
+	if(!try_get_message_swig())
+		return(false);
+
+	type = request.get_message_type();
+	interface = request.get_message_interface();
+	method = request.get_message_method();
+
+	return(true);
 }
 
-void DbusTinyServer::send_uint64_uint32_uint32_string_double(uint64_t p1, uint32_t p2, uint32_t p3, const std::string &p4, double p5)
+bool DbusTinyServer::try_get_message_swig()
 {
-	DBusMessage *reply_message;
-	const char *cstr;
+	DBusMessage *message;
 
-	cstr = p4.c_str();
+	check_unlimited("try_get_message");
 
-	if(!(reply_message = dbus_message_new_method_return(pending_message)))
-		throw(DbusTinyException("dbus_message_new_method_return failed"));
+	if(!(message = pop_message()))
+		return(false);
 
-	if(!dbus_message_append_args(reply_message, DBUS_TYPE_UINT64, &p1, DBUS_TYPE_UINT32, &p2, DBUS_TYPE_UINT32, &p3, DBUS_TYPE_STRING, &cstr, DBUS_TYPE_DOUBLE, &p5, DBUS_TYPE_INVALID))
-	{
-		dbus_message_unref(reply_message);
-		throw(DbusTinyException("dbus_message_append_args failed"));
-	}
+	request.set(bus_connection, message, &stats);
 
-	if(!dbus_connection_send(bus_connection, reply_message, NULL))
-	{
-		dbus_message_unref(reply_message);
-		throw(DbusTinyException("dbus_connection_send failed"));
-	}
+	return(true);
+}
 
-	dbus_message_unref(reply_message);
+int DbusTinyServer::poll_ready(std::vector<struct pollfd> &fds, int timeout)
+{
+	DbusTinyStatsTimer timer(stats.wait);
+
+	return(poll(fds.data(), fds.size(), timeout));
 }
 
-void DbusTinyServer::send_uint64_x3string_x4double(uint64_t p0, const std::string &p1, const std::string &p2, const std::string &p3, double p4, double p5, double p6, double p7)
+void DbusTinyServer::get_poll_fds(std::vector<struct pollfd> &fds)
 {
-	DBusMessage *reply_message;
-	const char *p1cs, *p2cs, *p3cs;
+	unsigned int flags;
+	int fd;
 
-	p1cs = p1.c_str();
-	p2cs = p2.c_str();
-	p3cs = p3.c_str();
+	std::lock_guard<std::mutex> lock(watch_mutex);
 
-	if(!(reply_message = dbus_message_new_method_return(pending_message)))
-		throw(DbusTinyException("dbus_message_new_method_return failed"));
+	fds.clear();
 
-	if(!dbus_message_append_args(reply_message,
-				DBUS_TYPE_UINT64, &p0, DBUS_TYPE_STRING, &p1cs, DBUS_TYPE_STRING, &p2cs, DBUS_TYPE_STRING, &p3cs,
-				DBUS_TYPE_DOUBLE, &p4, DBUS_TYPE_DOUBLE, &p5, DBUS_TYPE_DOUBLE, &p6, DBUS_TYPE_DOUBLE, &p7, DBUS_TYPE_INVALID))
+	for(auto &watch : watches)
 	{
-		dbus_message_unref(reply_message);
-		throw(DbusTinyException("dbus_message_append_args failed"));
-	}
+		if(!dbus_watch_get_enabled(watch))
+			continue;
 
-	if(!dbus_connection_send(bus_connection, reply_message, NULL))
-	{
-		dbus_message_unref(reply_message);
-		throw(DbusTinyException("dbus_connection_send failed"));
+		fd = dbus_watch_get_unix_fd(watch);
+		flags = dbus_watch_get_flags(watch);
+
+		auto it = fds.begin();
+
+		for(; it != fds.end(); it++)
+			if(it->fd == fd)
+				break;
+
+		if(it == fds.end())
+			it = fds.insert(fds.end(), { fd, 0, 0 });
+
+		if(flags & DBUS_WATCH_READABLE)
+			it->events |= POLLIN;
+
+		if(flags & DBUS_WATCH_WRITABLE)
+			it->events |= POLLOUT;
 	}
 
-	dbus_message_unref(reply_message);
+	if(wakeup_fd >= 0)
+		fds.push_back({ wakeup_fd, POLLIN, 0 });
 }
 
-void DbusTinyServer::send_uint32_x3uint64(uint32_t p0, uint64_t p1, uint64_t p2, uint64_t p3)
+int DbusTinyServer::get_poll_timeout()
 {
-	DBusMessage *reply_message;
+	if(dbus_connection_get_dispatch_status(bus_connection) == DBUS_DISPATCH_DATA_REMAINS)
+		return(0);
 
-	if(!(reply_message = dbus_message_new_method_return(pending_message)))
-		throw(DbusTinyException("dbus_message_new_method_return failed"));
+	return(get_timeout_remaining());
+}
 
-	if(!dbus_message_append_args(reply_message,
-				DBUS_TYPE_UINT32, &p0,
-				DBUS_TYPE_UINT64, &p1,
-				DBUS_TYPE_UINT64, &p2,
-				DBUS_TYPE_UINT64, &p3,
-				DBUS_TYPE_INVALID))
-	{
-		dbus_message_unref(reply_message);
-		throw(DbusTinyException("dbus_message_append_args failed"));
-	}
+int DbusTinyServer::get_timeout_remaining()
+{
+	std::chrono::steady_clock::time_point now;
+	std::chrono::milliseconds::rep remaining, rv;
+
+	std::lock_guard<std::mutex> lock(watch_mutex);
+
+	now = std::chrono::steady_clock::now();
+	rv = -1;
 
-	if(!dbus_connection_send(bus_connection, reply_message, NULL))
+	for(const auto &timeout : timeouts)
 	{
-		dbus_message_unref(reply_message);
-		throw(DbusTinyException("dbus_connection_send failed"));
+		if(!dbus_timeout_get_enabled(timeout.first))
+			continue;
+
+		remaining = std::chrono::ceil<std::chrono::milliseconds>(timeout.second - now).count();
+
+		if(remaining < 0)
+			remaining = 0;
+
+		if((rv < 0) || (remaining < rv))
+			rv = remaining;
 	}
 
-	dbus_message_unref(reply_message);
+	return(static_cast<int>(rv));
 }
 
-const std::string &DbusTinyServer::inform_error(const std::string &reason)
+void DbusTinyServer::dispatch_ready(const std::vector<struct pollfd> &fds)
 {
-	DBusMessage *error_message;
+	std::vector<std::pair<DBusWatch *, unsigned int>> ready_watches;
+	std::vector<DBusTimeout *> expired_timeouts;
+	std::chrono::steady_clock::time_point now;
+	unsigned int flags;
+	uint64_t counter;
+
+	{
+		std::lock_guard<std::mutex> lock(watch_mutex);
+
+		for(const auto &fd : fds)
+		{
+			if(!fd.revents)
+				continue;
+
+			if(fd.fd == wakeup_fd)
+			{
+				if(read(wakeup_fd, &counter, sizeof(counter)) < 0)
+					if(errno != EAGAIN)
+						throw(DbusTinyException("dispatch_ready: read wakeup failed"));
+
+				continue;
+			}
+
+			for(auto &watch : watches)
+			{
+				if(!dbus_watch_get_enabled(watch) || (dbus_watch_get_unix_fd(watch) != fd.fd))
+					continue;
+
+				flags = 0;
+
+				if(fd.revents & POLLIN)
+					flags |= DBUS_WATCH_READABLE;
+
+				if(fd.revents & POLLOUT)
+					flags |= DBUS_WATCH_WRITABLE;
+
+				flags &= dbus_watch_get_flags(watch);
+
+				if(fd.revents & POLLHUP)
+					flags |= DBUS_WATCH_HANGUP;
 
-	if(!(error_message = dbus_message_new_error(pending_message, DBUS_ERROR_FAILED, reason.c_str())))
-		throw(DbusTinyException("method error - error in dbus_message_new_error"));
+				if(fd.revents & POLLERR)
+					flags |= DBUS_WATCH_ERROR;
 
-	if(!dbus_connection_send(bus_connection, error_message, NULL))
-		throw(DbusTinyException("method error - error in dbus_connection_send"));
+				if(flags)
+					ready_watches.push_back(std::make_pair(watch, flags));
+			}
+		}
+
+		now = std::chrono::steady_clock::now();
+
+		for(auto &timeout : timeouts)
+		{
+			if(dbus_timeout_get_enabled(timeout.first) && (timeout.second <= now))
+			{
+				timeout.second = now + std::chrono::milliseconds(dbus_timeout_get_interval(timeout.first));
+				expired_timeouts.push_back(timeout.first);
+			}
+		}
+	}
 
-	dbus_message_unref(error_message);
+	for(auto &watch : ready_watches)
+		if(!dbus_watch_handle(watch.first, watch.second))
+			throw(DbusTinyException("dbus_watch_handle: out of memory"));
 
-	return(reason);
+	for(auto &timeout : expired_timeouts)
+		dbus_timeout_handle(timeout);
 }
 
-void DbusTinyServer::reset()
+const std::string &DbusTinyServer::receive_string()
 {
-	if(bus_connection)
-		dbus_connection_flush(bus_connection);
+	return(request.receive_string());
+}
 
-	if(pending_message)
-	{
-		dbus_message_unref(pending_message);
-		pending_message = nullptr;
-	}
+void DbusTinyServer::receive_x3string(std::string &p0, std::string &p1, std::string &p2)
+{
+	request.receive_x3string(p0, p1, p2);
 }
 
-const std::string &DbusTinyServer::get_message_type()
+void DbusTinyServer::receive_x3string_swig()
 {
-	return(message_type);
+	request.receive_x3string_swig();
 }
 
-const std::string &DbusTinyServer::get_message_interface()
+void DbusTinyServer::receive_uint32_uint32_string_string(uint32_t &p1, uint32_t &p2, std::string &p3, std::string &p4)
 {
-	return(message_interface);
+	request.receive_uint32_uint32_string_string(p1, p2, p3, p4);
 }
 
-const std::string &DbusTinyServer::get_message_method()
+void DbusTinyServer::receive_uint32_uint32_string_string_swig()
 {
-	return(message_method);
+	request.receive_uint32_uint32_string_string_swig();
 }
 
-uint32_t DbusTinyServer::get_rv_uint32_0()
+void DbusTinyServer::send_string(DbusTinyCString reply_string)
 {
-	return(rv_uint32_0);
+	request.send_string(reply_string);
 }
 
-uint32_t DbusTinyServer::get_rv_uint32_1()
+void DbusTinyServer::send_uint64_uint32_uint32_string_double(uint64_t p1, uint32_t p2, uint32_t p3, DbusTinyCString p4, double p5)
 {
-	return(rv_uint32_1);
+	request.send_uint64_uint32_uint32_string_double(p1, p2, p3, p4, p5);
 }
 
-const std::string &DbusTinyServer::get_rv_string_0()
+void DbusTinyServer::send_uint64_x3string_x4double(uint64_t p0, DbusTinyCString p1, DbusTinyCString p2, DbusTinyCString p3, double p4, double p5, double p6, double p7)
 {
-	return(rv_string_0);
+	request.send_uint64_x3string_x4double(p0, p1, p2, p3, p4, p5, p6, p7);
 }
 
-const std::string &DbusTinyServer::get_rv_string_1()
+void DbusTinyServer::send_uint32_x3uint64(uint32_t p0, uint64_t p1, uint64_t p2, uint64_t p3)
 {
-	return(rv_string_1);
+	request.send_uint32_x3uint64(p0, p1, p2, p3);
 }
 
-const std::string &DbusTinyServer::get_rv_string_2()
+const std::string &DbusTinyServer::inform_error(const std::string &reason)
+{
+	return(request.inform_error(reason));
+}
+
+void DbusTinyServer::reset()
 {
-	return(rv_string_2);
+	if(bus_connection)
+	{
+		if(flush_batching)
+			flush_due();
+		else
+			flush();
+	}
+
+	request.reset();
+}
+
+void DbusTinyServer::set_flush_batching(bool enable, unsigned int messages, unsigned int bytes, unsigned int delay_us)
+{
+	if(enable && (messages == 0))
+		throw(DbusTinyException("set_flush_batching: message threshold must be at least 1"));
+
+	if(flush_batching && !enable && bus_connection)
+		flush();
+
+	flush_batching = enable;
+	flush_messages = messages;
+	flush_bytes = bytes;
+	flush_delay = std::chrono::microseconds(delay_us);
+	unflushed = 0;
+}
+
+void DbusTinyServer::set_max_received_size(long bytes)
+{
+	if(bytes <= 0)
+		throw(DbusTinyException("set_max_received_size: size must be positive"));
+
+	dbus_connection_set_max_received_size(bus_connection, bytes);
+	received_size_set = true;
+}
+
+void DbusTinyServer::set_queue_limit(unsigned int high_watermark, DbusTinyOverload policy)
+{
+	queue_limit = high_watermark;
+	overload = policy;
+
+	if(queue_limit && (overload == DbusTinyOverload::block) && !received_size_set)
+		dbus_connection_set_max_received_size(bus_connection, default_max_received_size);
+}
+
+void DbusTinyServer::check_unlimited(const char *caller)
+{
+	if(queue_limit)
+		throw(DbusTinyException(boost::format("%s: the queue limit is only supported by run_workers") % caller));
+}
+
+bool DbusTinyServer::shed_message(DBusMessage *message)
+{
+	DbusTinyRequest shed_request;
+
+	if(dbus_message_get_type(message) == DBUS_MESSAGE_TYPE_SIGNAL)
+	{
+		DbusTinyStats::add(stats.signals_shed);
+		dbus_message_unref(message);
+		return(true);
+	}
+
+	if(dbus_message_get_type(message) == DBUS_MESSAGE_TYPE_METHOD_CALL)
+	{
+		DbusTinyStats::add(stats.calls_shed);
+		shed_request.set(bus_connection, message, &stats);
+
+		if(!dbus_message_get_no_reply(message))
+			shed_request.reply_error(DBUS_ERROR_LIMITS_EXCEEDED, "server busy");
+
+		return(true);
+	}
+
+	return(false);
+}
+
+void DbusTinyServer::flush()
+{
+	unflushed = 0;
+
+	if(!dbus_connection_has_messages_to_send(bus_connection))
+		return;
+
+	DbusTinyStats::add(stats.flushes);
+
+	dbus_connection_flush(bus_connection);
+}
+
+void DbusTinyServer::flush_due()
+{
+	std::chrono::steady_clock::time_point now;
+
+	if(!dbus_connection_has_messages_to_send(bus_connection))
+	{
+		unflushed = 0;
+		return;
+	}
+
+	now = std::chrono::steady_clock::now();
+
+	if(unflushed++ == 0)
+		unflushed_since = now;
+
+	if((unflushed >= flush_messages) || (static_cast<unsigned long>(dbus_connection_get_outgoing_size(bus_connection)) >= flush_bytes) ||
+			((now - unflushed_since) >= flush_delay))
+		flush();
+}
+
+void DbusTinyServer::run_workers(unsigned int threads, const std::function<void(DbusTinyRequest &)> &handler)
+{
+	std::vector<std::thread> workers;
+	std::deque<DbusTinyRequest> queue;
+	std::mutex queue_mutex;
+	std::condition_variable queue_condition;
+	std::vector<struct pollfd> fds;
+	DBusMessage *message;
+	bool done;
+
+	if(threads == 0)
+		throw(DbusTinyException("run_workers: no worker threads"));
+
+	stopping = false;
+	done = false;
+
+	auto queue_full = [&]()
+	{
+		if(queue_limit == 0)
+			return(false);
+
+		std::lock_guard<std::mutex> lock(queue_mutex);
+
+		return(queue.size() >= queue_limit);
+	};
+
+	auto worker = [&]()
+	{
+		DbusTinyRequest worker_request;
+		bool was_full;
+
+		for(;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(queue_mutex);
+
+				queue_condition.wait(lock, [&] { return(done || !queue.empty()); });
+
+				if(queue.empty())
+					return;
+
+				was_full = queue_limit && (queue.size() >= queue_limit);
+
+				worker_request = std::move(queue.front());
+				queue.pop_front();
+			}
+
+			if(was_full && (overload == DbusTinyOverload::block))
+				wakeup_main(this);
+
+			try
+			{
+				handler(worker_request);
+			}
+			catch(const std::exception &e)
+			{
+				if((worker_request.get_type() == DbusTinyMessageType::method_call) && !worker_request.has_replied())
+					worker_request.reply_error(DBUS_ERROR_FAILED, e.what());
+			}
+			catch(...)
+			{
+				if((worker_request.get_type() == DbusTinyMessageType::method_call) && !worker_request.has_replied())
+					worker_request.reply_error(DBUS_ERROR_FAILED, "handler failed");
+			}
+
+			worker_request.reset();
+		}
+	};
+
+	for(unsigned int ix = 0; ix < threads; ix++)
+		workers.emplace_back(worker);
+
+	try
+	{
+		while(!stopping)
+		{
+			get_poll_fds(fds);
+
+			if(poll_ready(fds, ((overload == DbusTinyOverload::block) && queue_full()) ? get_timeout_remaining() : get_poll_timeout()) < 0)
+			{
+				if(errno == EINTR)
+					continue;
+
+				throw(DbusTinyException("run_workers: poll failed"));
+			}
+
+			dispatch_ready(fds);
+
+			while(!((overload == DbusTinyOverload::block) && queue_full()) && (message = pop_message()))
+			{
+				DbusTinyRequest new_request;
+
+				if((overload == DbusTinyOverload::shed) && queue_full() && shed_message(message))
+					continue;
+
+				new_request.set(bus_connection, message, &stats);
+
+				std::lock_guard<std::mutex> lock(queue_mutex);
+
+				queue.push_back(std::move(new_request));
+				queue_condition.notify_one();
+			}
+		}
+	}
+	catch(...)
+	{
+		{
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			done = true;
+		}
+
+		queue_condition.notify_all();
+
+		for(auto &thread : workers)
+			thread.join();
+
+		throw;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		done = true;
+	}
+
+	queue_condition.notify_all();
+
+	for(auto &thread : workers)
+		thread.join();
+
+	dbus_connection_flush(bus_connection);
+}
+
+void DbusTinyServer::run_workers(unsigned int threads)
+{
+	run_workers(threads, [this](DbusTinyRequest &worker_request)
+	{
+		if(!dispatch(worker_request) && (worker_request.get_type() == DbusTinyMessageType::method_call))
+			worker_request.reply_error(DBUS_ERROR_UNKNOWN_METHOD, "unknown method");
+	});
+}
+
+DbusTinyMessageAwaiter DbusTinyServer::next_message()
+{
+	return(DbusTinyMessageAwaiter(*this));
+}
+
+bool DbusTinyServer::resume_waiters()
+{
+	DBusMessage *message;
+	message_waiter waiter;
+	bool rv;
+
+	rv = false;
+
+	check_unlimited("resume_waiters");
+
+	while(!message_waiters.empty() && (message = pop_message()))
+	{
+		waiter = message_waiters.front();
+		message_waiters.pop_front();
+
+		waiter.request->set(bus_connection, message, &stats);
+		waiter.handle.resume();
+
+		rv = true;
+
+		DbusTinyTask::rethrow_unhandled();
+	}
+
+	return(rv);
+}
+
+void DbusTinyServer::run_coroutines(const std::vector<DbusTinyClient *> &clients)
+{
+	std::vector<struct pollfd> fds;
+	size_t server_fds;
+	int poll_timeout, client_timeout;
+
+	stopping = false;
+
+	while(!stopping)
+	{
+		DbusTinyTask::rethrow_unhandled();
+
+		resume_waiters();
+
+		if(stopping)
+			break;
+
+		get_poll_fds(fds);
+		server_fds = fds.size();
+
+		if(message_waiters.empty())
+			poll_timeout = get_timeout_remaining();
+		else
+			poll_timeout = get_poll_timeout();
+
+		for(auto &client : clients)
+		{
+			fds.push_back({ client->get_poll_fd(), POLLIN, 0 });
+
+			client_timeout = client->get_poll_timeout();
+
+			if((client_timeout >= 0) && ((poll_timeout < 0) || (client_timeout < poll_timeout)))
+				poll_timeout = client_timeout;
+		}
+
+		if(poll_ready(fds, poll_timeout) < 0)
+		{
+			if(errno == EINTR)
+				continue;
+
+			throw(DbusTinyException("run_coroutines: poll failed"));
+		}
+
+		fds.resize(server_fds);
+		dispatch_ready(fds);
+
+		for(auto &client : clients)
+			client->process(0);
+	}
+}
+
+void DbusTinyServer::stop()
+{
+	stopping = true;
+	wakeup_main(this);
+}
+
+const std::string &DbusTinyServer::get_message_type()
+{
+	return(request.get_message_type());
+}
+
+const std::string &DbusTinyServer::get_message_interface()
+{
+	return(request.get_message_interface());
+}
+
+const std::string &DbusTinyServer::get_message_method()
+{
+	return(request.get_message_method());
+}
+
+const std::string &DbusTinyServer::get_message_path()
+{
+	return(request.get_message_path());
+}
+
+uint32_t DbusTinyServer::get_rv_uint32_0()
+{
+	return(request.get_rv_uint32_0());
+}
+
+uint32_t DbusTinyServer::get_rv_uint32_1()
+{
+	return(request.get_rv_uint32_1());
+}
+
+const std::string &DbusTinyServer::get_rv_string_0()
+{
+	return(request.get_rv_string_0());
+}
+
+const std::string &DbusTinyServer::get_rv_string_1()
+{
+	return(request.get_rv_string_1());
+}
+
+const std::string &DbusTinyServer::get_rv_string_2()
+{
+	return(request.get_rv_string_2());
+}
+
+void DbusTinyServer::add_method(const std::string &interface, const std::string &method, const std::string &in_signature, const std::string &out_signature,
+		const DbusTinyHandler &handler)
+{
+	if(!dbus_validate_interface(interface.c_str(), nullptr))
+		throw(DbusTinyException(boost::format("add_method: invalid interface: %s") % interface));
+
+	if(!dbus_validate_member(method.c_str(), nullptr))
+		throw(DbusTinyException(boost::format("add_method: invalid method: %s") % method));
+
+	if(!dbus_signature_validate(in_signature.c_str(), nullptr) || !dbus_signature_validate(out_signature.c_str(), nullptr))
+		throw(DbusTinyException(boost::format("add_method: invalid signature for method %s") % method));
+
+	registry_method &entry = registry[interface].methods[method];
+
+	entry.in_signature = in_signature;
+	entry.out_signature = out_signature;
+	entry.handler = handler;
+
+	invalidate_introspection();
+	dispatch_valid = false;
+}
+
+void DbusTinyServer::add_method(const std::string &interface, const std::string &method, const std::string &in_signature, const std::string &out_signature)
+{
+	add_method(interface, method, in_signature, out_signature, DbusTinyHandler());
+}
+
+void DbusTinyServer::add_signal(const std::string &interface, const std::string &signal, const std::string &signature)
+{
+	if(!dbus_validate_interface(interface.c_str(), nullptr))
+		throw(DbusTinyException(boost::format("add_signal: invalid interface: %s") % interface));
+
+	if(!dbus_validate_member(signal.c_str(), nullptr))
+		throw(DbusTinyException(boost::format("add_signal: invalid signal: %s") % signal));
+
+	if(!dbus_signature_validate(signature.c_str(), nullptr))
+		throw(DbusTinyException(boost::format("add_signal: invalid signature for signal %s") % signal));
+
+	registry[interface].signals[signal] = signature;
+
+	invalidate_introspection();
+	dispatch_valid = false;
+}
+
+void DbusTinyServer::add_object(const std::string &path, bool fallback, const DbusTinyHandler &handler)
+{
+	object_node *node;
+	size_t start, end;
+
+	if(!dbus_validate_path(path.c_str(), nullptr))
+		throw(DbusTinyException(boost::format("add_object: invalid path: %s") % path));
+
+	node = &object_root;
+
+	for(start = 1; start < path.length(); start = end + 1)
+	{
+		if((end = path.find('/', start)) == std::string::npos)
+			end = path.length();
+
+		auto &child = node->children[path.substr(start, end - start)];
+
+		if(!child)
+			child = std::make_unique<object_node>();
+
+		node = child.get();
+	}
+
+	if(!node->object)
+		object_count++;
+
+	node->object = true;
+	node->fallback = fallback;
+	node->handler = handler;
+
+	invalidate_introspection();
+}
+
+void DbusTinyServer::add_object(const std::string &path, bool fallback)
+{
+	add_object(path, fallback, DbusTinyHandler());
+}
+
+void DbusTinyServer::add_stats_method(const std::string &interface)
+{
+	add_method(interface, "GetStats", "", "a{st}", [this](DbusTinyRequest &stats_request)
+	{
+		stats_request.reply(stats.values());
+	});
+}
+
+const DbusTinyStats &DbusTinyServer::get_stats()
+{
+	return(stats);
+}
+
+void DbusTinyServer::remove_object(const std::string &path)
+{
+	std::vector<std::pair<object_node *, std::string_view>> trail;
+	object_node *node;
+	size_t start, end;
+
+	node = &object_root;
+
+	for(start = 1; start < path.length(); start = end + 1)
+	{
+		if((end = path.find('/', start)) == std::string::npos)
+			end = path.length();
+
+		std::string_view segment(path.data() + start, end - start);
+		auto child = node->children.find(segment);
+
+		if(child == node->children.end())
+			throw(DbusTinyException(boost::format("remove_object: unknown object: %s") % path));
+
+		trail.push_back({ node, segment });
+		node = child->second.get();
+	}
+
+	if(!node->object)
+		throw(DbusTinyException(boost::format("remove_object: unknown object: %s") % path));
+
+	node->object = false;
+	node->fallback = false;
+	node->handler = DbusTinyHandler();
+	object_count--;
+
+	invalidate_introspection();
+
+	for(auto step = trail.rbegin(); step != trail.rend(); step++)
+	{
+		auto child = step->first->children.find(step->second);
+
+		if(child->second->object || !child->second->children.empty())
+			break;
+
+		step->first->children.erase(child);
+	}
+}
+
+const DbusTinyServer::object_node *DbusTinyServer::find_object(std::string_view path, const object_node *&fallback)
+{
+	const object_node *node;
+	size_t start, end;
+
+	node = &object_root;
+	fallback = object_root.fallback ? &object_root : nullptr;
+
+	for(start = 1; start < path.length(); start = end + 1)
+	{
+		if((end = path.find('/', start)) == std::string_view::npos)
+			end = path.length();
+
+		auto child = node->children.find(path.substr(start, end - start));
+
+		if(child == node->children.end())
+			return(nullptr);
+
+		node = child->second.get();
+
+		if(node->fallback)
+			fallback = node;
+	}
+
+	return(node);
+}
+
+std::string DbusTinyServer::get_introspection(const std::string &path)
+{
+	const object_node *node;
+	const object_node *fallback;
+
+	if(!object_count)
+		return(get_introspection());
+
+	if((node = find_object(path, fallback)))
+		return(introspect_object(node, node->object || fallback));
+
+	if(fallback)
+		return(introspect_object(nullptr, true));
+
+	throw(DbusTinyException(boost::format("get_introspection: unknown object: %s") % path));
+}
+
+const std::string &DbusTinyServer::introspect_object(const object_node *node, bool object)
+{
+	std::vector<std::string_view> children;
+	std::string xml;
+
+	{
+		std::lock_guard<std::mutex> lock(introspection_mutex);
+
+		auto cached = object_introspection.find({ node, object });
+
+		if(cached != object_introspection.end())
+			return(cached->second);
+	}
+
+	if(object)
+	{
+		xml = get_introspection();
+		xml.resize(xml.length() - (sizeof("</node>\n") - 1));
+	}
+	else
+		xml =
+				"<!DOCTYPE node PUBLIC \"-//freedesktop//DTD D-BUS Object Introspection 1.0//EN\" \"http://www.freedesktop.org/standards/dbus/1.0/introspect.dtd\">\n"
+				"<node>\n";
+
+	if(node)
+	{
+		for(const auto &child : node->children)
+			children.push_back(child.first);
+
+		std::sort(children.begin(), children.end());
+
+		for(const auto &child : children)
+		{
+			xml += "	<node name=\"";
+			xml += child;
+			xml += "\"/>\n";
+		}
+	}
+
+	xml += "</node>\n";
+
+	std::lock_guard<std::mutex> lock(introspection_mutex);
+
+	return(object_introspection.try_emplace({ node, object }, std::move(xml)).first->second);
+}
+
+void DbusTinyServer::invalidate_introspection()
+{
+	std::lock_guard<std::mutex> lock(introspection_mutex);
+
+	introspection_valid = false;
+	object_introspection.clear();
+}
+
+const std::string &DbusTinyServer::get_introspection()
+{
+	if(introspection_valid)
+		return(introspection);
+
+	std::lock_guard<std::mutex> lock(introspection_mutex);
+
+	if(introspection_valid)
+		return(introspection);
+
+	introspection =
+			"<!DOCTYPE node PUBLIC \"-//freedesktop//DTD D-BUS Object Introspection 1.0//EN\" \"http://www.freedesktop.org/standards/dbus/1.0/introspect.dtd\">\n"
+			"<node>\n"
+			"	<interface name=\"org.freedesktop.DBus.Introspectable\">\n"
+			"		<method name=\"Introspect\">\n"
+			"			<arg name=\"xml\" type=\"s\" direction=\"out\"/>\n"
+			"		</method>\n"
+			"	</interface>\n";
+
+	for(const auto &interface : registry)
+	{
+		introspection += "	<interface name=\"" + interface.first + "\">\n";
+
+		for(const auto &method : interface.second.methods)
+		{
+			introspection += "		<method name=\"" + method.first + "\">\n";
+			introspect_arguments(introspection, method.second.in_signature, "argument", "in");
+			introspect_arguments(introspection, method.second.out_signature, "reply", "out");
+			introspection += "		</method>\n";
+		}
+
+		for(const auto &signal : interface.second.signals)
+		{
+			introspection += "		<signal name=\"" + signal.first + "\">\n";
+			introspect_arguments(introspection, signal.second, "argument", nullptr);
+			introspection += "		</signal>\n";
+		}
+
+		introspection += "	</interface>\n";
+	}
+
+	introspection += "</node>\n";
+
+	introspection_valid = true;
+
+	return(introspection);
+}
+
+void DbusTinyServer::introspect_arguments(std::string &xml, const std::string &signature, const char *name, const char *direction)
+{
+	DBusSignatureIter iter;
+	char *type;
+	unsigned int index;
+
+	if(signature.empty())
+		return;
+
+	dbus_signature_iter_init(&iter, signature.c_str());
+
+	index = 1;
+
+	do
+	{
+		type = dbus_signature_iter_get_signature(&iter);
+
+		xml += (boost::format("			<arg name=\"%s_%u\" type=\"%s\"") % name % index % type).str();
+
+		if(direction)
+			xml += std::string(" direction=\"") + direction + "\"";
+
+		xml += "/>\n";
+
+		dbus_free(type);
+		index++;
+	}
+	while(dbus_signature_iter_next(&iter));
+}
+
+bool DbusTinyServer::dispatch()
+{
+	return(dispatch(request));
+}
+
+void DbusTinyServer::dispatch_error(DbusTinyRequest &dispatch_request, const char *name, const char *reason)
+{
+	DbusTinyResult result;
+
+	if(!(result = dispatch_request.reply_error(name, reason)))
+		result.raise("method error - ");
+}
+
+bool DbusTinyServer::dispatch(DbusTinyRequest &dispatch_request)
+{
+	const dispatch_slot *slot;
+	const object_node *node;
+	const object_node *fallback;
+	const char *interface;
+	const char *method;
+
+	if(!dispatch_request.message || (dbus_message_get_type(dispatch_request.message) != DBUS_MESSAGE_TYPE_METHOD_CALL))
+		return(false);
+
+	interface = dbus_message_get_interface(dispatch_request.message) ? : "";
+	method = dbus_message_get_member(dispatch_request.message) ? : "";
+
+	if(!dispatch_valid)
+		build_dispatch_table();
+
+	if(!(slot = find_dispatch_slot(interface, method)))
+	{
+		if(*interface && (registry.find(interface) == registry.end()))
+			dispatch_error(dispatch_request, DBUS_ERROR_UNKNOWN_INTERFACE, "unknown interface");
+		else
+			dispatch_error(dispatch_request, DBUS_ERROR_UNKNOWN_METHOD, "unknown method");
+
+		return(true);
+	}
+
+	node = nullptr;
+	fallback = nullptr;
+
+	if(object_count)
+	{
+		node = find_object(dbus_message_get_path(dispatch_request.message) ? : "/", fallback);
+
+		if(!slot->entry && (node || fallback))
+		{
+			dispatch_request.send_string(introspect_object(node, (node && node->object) || fallback));
+			return(true);
+		}
+
+		if(!node || !node->object)
+			node = fallback;
+
+		if(!node)
+		{
+			dispatch_error(dispatch_request, DBUS_ERROR_UNKNOWN_OBJECT, "unknown object");
+			return(true);
+		}
+	}
+
+	if(!slot->entry)
+	{
+		dispatch_request.send_string(get_introspection());
+		return(true);
+	}
+
+	const DbusTinyHandler &handler = (node && node->handler) ? node->handler : slot->entry->handler;
+
+	if(!handler)
+		return(false);
+
+	if(!dbus_message_has_signature(dispatch_request.message, slot->entry->in_signature.c_str()))
+	{
+		dispatch_error(dispatch_request, DBUS_ERROR_INVALID_ARGS, "invalid arguments");
+		return(true);
+	}
+
+	{
+		DbusTinyStatsTimer timer(stats.handler);
+
+		handler(dispatch_request);
+	}
+
+	return(true);
+}
+
+static uint64_t dispatch_hash(const char *interface, const char *method)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	for(; *interface; interface++)
+		hash = (hash ^ static_cast<unsigned char>(*interface)) * 0x100000001b3ULL;
+
+	hash = (hash ^ '/') * 0x100000001b3ULL;
+
+	for(; *method; method++)
+		hash = (hash ^ static_cast<unsigned char>(*method)) * 0x100000001b3ULL;
+
+	return(hash);
+}
+
+void DbusTinyServer::build_dispatch_table()
+{
+	std::lock_guard<std::mutex> lock(dispatch_mutex);
+	size_t entries, size;
+
+	if(dispatch_valid)
+		return;
+
+	entries = 2;
+
+	for(const auto &interface : registry)
+		entries += interface.second.methods.size() * 2;
+
+	for(size = 16; size < (entries * 2); size *= 2)
+		;
+
+	dispatch_table.assign(size, { 0, nullptr, nullptr, nullptr });
+
+	insert_dispatch_slot("org.freedesktop.DBus.Introspectable", "Introspect", nullptr);
+	insert_dispatch_slot("", "Introspect", nullptr);
+
+	for(const auto &interface : registry)
+		for(const auto &method : interface.second.methods)
+			insert_dispatch_slot(interface.first.c_str(), method.first.c_str(), &method.second);
+
+	for(const auto &interface : registry)
+		for(const auto &method : interface.second.methods)
+			if(!find_dispatch_slot("", method.first.c_str()))
+				insert_dispatch_slot("", method.first.c_str(), &method.second);
+
+	dispatch_valid = true;
+}
+
+void DbusTinyServer::insert_dispatch_slot(const char *interface, const char *method, const registry_method *entry)
+{
+	uint64_t hash;
+	size_t mask, ix;
+
+	hash = dispatch_hash(interface, method);
+	mask = dispatch_table.size() - 1;
+
+	for(ix = hash & mask; dispatch_table[ix].method; ix = (ix + 1) & mask)
+		;
+
+	dispatch_table[ix] = { hash, interface, method, entry };
+}
+
+const DbusTinyServer::dispatch_slot *DbusTinyServer::find_dispatch_slot(const char *interface, const char *method)
+{
+	uint64_t hash;
+	size_t mask, ix;
+
+	hash = dispatch_hash(interface, method);
+	mask = dispatch_table.size() - 1;
+
+	for(ix = hash & mask; dispatch_table[ix].method; ix = (ix + 1) & mask)
+		if((dispatch_table[ix].hash == hash) && !strcmp(dispatch_table[ix].method, method) && !strcmp(dispatch_table[ix].interface, interface))
+			return(&dispatch_table[ix]);
+
+	return(nullptr);
+}
+
+dbus_bool_t DbusTinyServer::add_watch(DBusWatch *watch, void *data)
+{
+	DbusTinyServer *server = static_cast<DbusTinyServer *>(data);
+	std::lock_guard<std::mutex> lock(server->watch_mutex);
+
+	server->watches.push_back(watch);
+
+	return(true);
+}
+
+void DbusTinyServer::remove_watch(DBusWatch *watch, void *data)
+{
+	DbusTinyServer *server = static_cast<DbusTinyServer *>(data);
+	std::lock_guard<std::mutex> lock(server->watch_mutex);
+
+	for(auto it = server->watches.begin(); it != server->watches.end(); it++)
+	{
+		if(*it == watch)
+		{
+			server->watches.erase(it);
+			break;
+		}
+	}
+}
+
+void DbusTinyServer::toggle_watch(DBusWatch *, void *data)
+{
+	wakeup_main(data);
+}
+
+dbus_bool_t DbusTinyServer::add_timeout(DBusTimeout *timeout, void *data)
+{
+	DbusTinyServer *server = static_cast<DbusTinyServer *>(data);
+	std::lock_guard<std::mutex> lock(server->watch_mutex);
+
+	server->timeouts[timeout] = std::chrono::steady_clock::now() + std::chrono::milliseconds(dbus_timeout_get_interval(timeout));
+
+	return(true);
+}
+
+void DbusTinyServer::remove_timeout(DBusTimeout *timeout, void *data)
+{
+	DbusTinyServer *server = static_cast<DbusTinyServer *>(data);
+	std::lock_guard<std::mutex> lock(server->watch_mutex);
+
+	server->timeouts.erase(timeout);
+}
+
+void DbusTinyServer::toggle_timeout(DBusTimeout *timeout, void *data)
+{
+	add_timeout(timeout, data);
+}
+
+void DbusTinyServer::new_connection(DBusServer *, DBusConnection *connection, void *data)
+{
+	DbusTinyServer *server = static_cast<DbusTinyServer *>(data);
+
+	if(server->bus_connection)
+		return;
+
+	dbus_connection_ref(connection);
+	server->bus_connection = connection;
+}
+
+void DbusTinyServer::wakeup_main(void *data)
+{
+	DbusTinyServer *server = static_cast<DbusTinyServer *>(data);
+	uint64_t counter = 1;
+
+	if(write(server->wakeup_fd, &counter, sizeof(counter)) < 0)
+		return;
 }
@@ -0,0 +1,268 @@
+#include <dbus-tiny.h>
+
+#include <dbus/dbus.h>
+
+#include <string>
+#include <vector>
+#include <boost/format.hpp>
+
+DbusTinySharedClient::DbusTinySharedClient(DbusTinyBus bus_type_in, const std::string &address, unsigned int connection_count)
+{
+	bus_type = bus_type_in;
+	connection_index = 0;
+	timeout = -1;
+
+	if(connection_count == 0)
+		throw(DbusTinyException("shared client: no connections"));
+
+	if(!dbus_threads_init_default())
+		throw(DbusTinyException("dbus_threads_init_default failed"));
+
+	try
+	{
+		for(unsigned int ix = 0; ix < connection_count; ix++)
+			connections.push_back(open_connection(address));
+	}
+	catch(...)
+	{
+		for(auto &connection : connections)
+		{
+			dbus_connection_close(connection);
+			dbus_connection_unref(connection);
+		}
+
+		throw;
+	}
+}
+
+DbusTinySharedClient::~DbusTinySharedClient()
+{
+	for(auto &connection : connections)
+	{
+		dbus_connection_close(connection);
+		dbus_connection_unref(connection);
+	}
+}
+
+DBusConnection *DbusTinySharedClient::open_connection(const std::string &address)
+{
+	DBusConnection *connection;
+	DBusError dbus_error;
+	std::string error_message;
+	DBusBusType type;
+
+	dbus_error_init(&dbus_error);
+
+	type = (bus_type == DbusTinyBus::session) ? DBUS_BUS_SESSION : DBUS_BUS_SYSTEM;
+
+	if((bus_type == DbusTinyBus::address) || (bus_type == DbusTinyBus::peer))
+	{
+		if((connection = dbus_connection_open_private(address.c_str(), &dbus_error)) && (bus_type == DbusTinyBus::address))
+			dbus_bus_register(connection, &dbus_error);
+	}
+	else
+		connection = dbus_bus_get_private(type, &dbus_error);
+
+	if(dbus_error_is_set(&dbus_error))
+	{
+		error_message = dbus_error.message;
+		dbus_error_free(&dbus_error);
+
+		if(connection)
+		{
+			dbus_connection_close(connection);
+			dbus_connection_unref(connection);
+		}
+
+		throw(DbusTinyException(boost::format("dbus bus get failed: %s") % error_message));
+	}
+
+	if(!connection)
+		throw(DbusTinyException("dbus bus get failed (bus_connection = nullptr)"));
+
+	dbus_connection_set_exit_on_disconnect(connection, false);
+
+	return(connection);
+}
+
+void DbusTinySharedClient::set_timeout(int milliseconds)
+{
+	timeout = milliseconds;
+}
+
+int DbusTinySharedClient::get_timeout()
+{
+	return(timeout);
+}
+
+DBusConnection *DbusTinySharedClient::next_connection()
+{
+	return(connections[connection_index.fetch_add(1, std::memory_order_relaxed) % connections.size()]);
+}
+
+void DbusTinySharedClient::drain(DBusConnection *connection)
+{
+	while(dbus_connection_dispatch(connection) == DBUS_DISPATCH_DATA_REMAINS)
+		continue;
+}
+
+DbusTinyResult DbusTinySharedClient::build_call(DBusMessage *&request_message, const std::string &service, const std::string &interface, const std::string &method, const std::string &path)
+{
+	request_message = nullptr;
+
+	if(!dbus_validate_bus_name(service.c_str(), nullptr))
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_INVALID_ARGS, "invalid service"));
+
+	if((interface != "") && !dbus_validate_interface(interface.c_str(), nullptr))
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_INVALID_ARGS, "invalid interface"));
+
+	if(!dbus_validate_member(method.c_str(), nullptr))
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_INVALID_ARGS, "invalid method"));
+
+	if(!dbus_validate_path(path.c_str(), nullptr))
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_INVALID_ARGS, "invalid path"));
+
+	if(!(request_message = dbus_message_new_method_call(service.c_str(), path.c_str(), (interface == "") ? nullptr : interface.c_str(), method.c_str())))
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_NO_MEMORY, "error in dbus_message_new_method_call"));
+
+	return(DbusTinyResult());
+}
+
+DBusMessage *DbusTinySharedClient::new_call(const std::string &service, const std::string &interface, const std::string &method, const std::string &path)
+{
+	DBusMessage *request_message;
+	DbusTinyResult result;
+
+	if(!(result = build_call(request_message, service, interface, method, path)))
+		result.raise("send: ");
+
+	return(request_message);
+}
+
+DBusMessage *DbusTinySharedClient::new_signal(const std::string &path, const std::string &interface, const std::string &signal)
+{
+	DBusMessage *signal_message;
+
+	if(!dbus_validate_path(path.c_str(), nullptr))
+		throw(DbusTinyException("signal: invalid path"));
+
+	if(!dbus_validate_interface(interface.c_str(), nullptr))
+		throw(DbusTinyException("signal: invalid interface"));
+
+	if(!dbus_validate_member(signal.c_str(), nullptr))
+		throw(DbusTinyException("signal: invalid signal name"));
+
+	if(!(signal_message = dbus_message_new_signal(path.c_str(), interface.c_str(), signal.c_str())))
+		throw(DbusTinyException("signal: error in dbus_message_new_signal"));
+
+	return(signal_message);
+}
+
+DbusTinyResult DbusTinySharedClient::exchange(DBusMessage *request_message, int milliseconds, DBusMessage *&reply_message)
+{
+	DBusConnection *connection;
+	DBusPendingCall *pending_call;
+
+	reply_message = nullptr;
+	pending_call = nullptr;
+	connection = next_connection();
+
+	if(!dbus_connection_send_with_reply(connection, request_message, &pending_call, milliseconds) || !pending_call)
+	{
+		dbus_message_unref(request_message);
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_DISCONNECTED, "error in dbus_connection_send_with_reply"));
+	}
+
+	dbus_message_unref(request_message);
+
+	DbusTinyStats::add(stats.calls_sent);
+
+	{
+		DbusTinyStatsTimer timer(stats.wait);
+
+		dbus_pending_call_block(pending_call);
+	}
+
+	reply_message = dbus_pending_call_steal_reply(pending_call);
+	dbus_pending_call_unref(pending_call);
+
+	drain(connection);
+
+	if(!reply_message)
+		return(DbusTinyResult(DbusTinyStatus::error, DBUS_ERROR_FAILED, "nullptr in dbus_pending_call_steal_reply"));
+
+	stats.received(reply_message);
+
+	if(dbus_message_get_type(reply_message) == DBUS_MESSAGE_TYPE_ERROR)
+	{
+		DbusTinyResult result(reply_message);
+
+		reply_message = nullptr;
+
+		if(result.get_status() == DbusTinyStatus::timeout)
+			DbusTinyStats::add(stats.timeouts);
+
+		return(result);
+	}
+
+	return(DbusTinyResult());
+}
+
+DBusMessage *DbusTinySharedClient::send_call(DBusMessage *request_message, int milliseconds)
+{
+	DBusMessage *reply_message;
+	DbusTinyResult result;
+
+	if(!(result = exchange(request_message, milliseconds, reply_message)))
+		result.raise("receive: ");
+
+	return(reply_message);
+}
+
+void DbusTinySharedClient::send_signal(DBusMessage *signal_message)
+{
+	DBusConnection *connection;
+
+	connection = next_connection();
+
+	if(!dbus_connection_send(connection, signal_message, nullptr))
+	{
+		dbus_message_unref(signal_message);
+		throw(DbusTinyException("signal: error in dbus_connection_send"));
+	}
+
+	dbus_message_unref(signal_message);
+	dbus_connection_flush(connection);
+
+	DbusTinyStats::add(stats.signals_sent);
+}
+
+const DbusTinyStats &DbusTinySharedClient::get_stats()
+{
+	return(stats);
+}
+
+void DbusTinySharedClient::append_failed(DBusMessage *message)
+{
+	dbus_message_unref(message);
+
+	throw(DbusTinyException("send: error in dbus_message_iter_append"));
+}
+
+void DbusTinySharedClient::fds_unsupported(DBusMessage *message)
+{
+	dbus_message_unref(message);
+
+	throw(DbusTinyException("send: connection cannot pass unix fds"));
+}
+
+void DbusTinySharedClient::receive_failed(DBusMessage *reply_message, const char *signature)
+{
+	std::string error;
+
+	error = (boost::format("receive: invalid reply, expected signature \"%s\", received \"%s\"") % signature % dbus_message_get_signature(reply_message)).str();
+
+	dbus_message_unref(reply_message);
+
+	throw(DbusTinyException(error));
+}
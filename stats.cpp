@@ -0,0 +1,86 @@
+#include <dbus-tiny-stats.h>
+
+#include <stdint.h>
+#include <dbus/dbus.h>
+
+#include <atomic>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+
+static std::mutex marshal_mutex;
+static std::map<std::string, std::unique_ptr<DbusTinyHistogram>> marshal_histograms;
+
+DbusTinyStats::DbusTinyStats()
+{
+	method_calls_received = 0;
+	method_returns_received = 0;
+	errors_received = 0;
+	signals_received = 0;
+	signals_dropped = 0;
+	calls_sent = 0;
+	replies_sent = 0;
+	errors_sent = 0;
+	signals_sent = 0;
+	timeouts = 0;
+	flushes = 0;
+	calls_shed = 0;
+	signals_shed = 0;
+}
+
+void DbusTinyStats::received(DBusMessage *message)
+{
+	if constexpr(enabled)
+	{
+		switch(dbus_message_get_type(message))
+		{
+			case(DBUS_MESSAGE_TYPE_METHOD_CALL): add(method_calls_received); break;
+			case(DBUS_MESSAGE_TYPE_METHOD_RETURN): add(method_returns_received); break;
+			case(DBUS_MESSAGE_TYPE_ERROR): add(errors_received); break;
+			case(DBUS_MESSAGE_TYPE_SIGNAL): add(signals_received); break;
+			default: break;
+		}
+	}
+}
+
+std::map<std::string, uint64_t> DbusTinyStats::values() const
+{
+	std::map<std::string, uint64_t> rv;
+
+	rv["received.method_call"] = method_calls_received;
+	rv["received.method_return"] = method_returns_received;
+	rv["received.error"] = errors_received;
+	rv["received.signal"] = signals_received;
+	rv["dropped.signal"] = signals_dropped;
+	rv["sent.method_call"] = calls_sent;
+	rv["sent.method_return"] = replies_sent;
+	rv["sent.error"] = errors_sent;
+	rv["sent.signal"] = signals_sent;
+	rv["timeouts"] = timeouts;
+	rv["flushes"] = flushes;
+	rv["shed.method_call"] = calls_shed;
+	rv["shed.signal"] = signals_shed;
+
+	wait.values("wait", rv);
+	handler.values("handler", rv);
+
+	std::lock_guard<std::mutex> lock(marshal_mutex);
+
+	for(const auto &histogram : marshal_histograms)
+		histogram.second->values("marshal." + histogram.first, rv);
+
+	return(rv);
+}
+
+DbusTinyHistogram &DbusTinyStats::marshal_histogram(const char *name)
+{
+	std::lock_guard<std::mutex> lock(marshal_mutex);
+
+	auto &histogram = marshal_histograms[name];
+
+	if(!histogram)
+		histogram = std::make_unique<DbusTinyHistogram>();
+
+	return(*histogram);
+}
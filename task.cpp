@@ -0,0 +1,42 @@
+#include <dbus-tiny.h>
+
+#include <coroutine>
+
+thread_local std::exception_ptr DbusTinyTask::unhandled;
+
+DbusTinyTask DbusTinyTask::promise_type::get_return_object()
+{
+	return(DbusTinyTask());
+}
+
+std::suspend_never DbusTinyTask::promise_type::initial_suspend() noexcept
+{
+	return(std::suspend_never());
+}
+
+std::suspend_never DbusTinyTask::promise_type::final_suspend() noexcept
+{
+	return(std::suspend_never());
+}
+
+void DbusTinyTask::promise_type::return_void()
+{
+}
+
+void DbusTinyTask::promise_type::unhandled_exception()
+{
+	if(!unhandled)
+		unhandled = std::current_exception();
+}
+
+void DbusTinyTask::rethrow_unhandled()
+{
+	std::exception_ptr exception;
+
+	if(unhandled)
+	{
+		exception = unhandled;
+		unhandled = nullptr;
+		std::rethrow_exception(exception);
+	}
+}